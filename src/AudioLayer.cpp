@@ -0,0 +1,158 @@
+#include "AudioLayer.h"
+#include "Chip8.h"
+
+#include <SDL2/SDL.h>
+
+#include <chrono>
+#include <cmath>
+
+namespace Chip8Emu
+{
+
+namespace
+{
+
+constexpr short Amplitude = 3000;
+constexpr unsigned int PatternBits = AudioPatternSize * 8;
+
+long long Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+AudioLayer::AudioLayer(int bufferSamples, int frequency)
+{
+    // Own subsystem, so the missing audio driver doesn't take the video down with it.
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+    {
+        return;
+    }
+    subsystemStarted = true;
+
+    SDL_AudioSpec desired{};
+    desired.freq = frequency;
+    desired.format = AUDIO_S16SYS;
+    desired.channels = 1;
+    int samples = MinAudioBufferSamples;
+    while (samples < bufferSamples && samples < MaxAudioBufferSamples)
+    {
+        samples <<= 1;
+    }
+    desired.samples = static_cast<Uint16>(samples);
+    desired.callback = &AudioLayer::Callback;
+    desired.userdata = this;
+
+    SDL_AudioSpec obtained{};
+    device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+    if (device == 0)
+    {
+        return;
+    }
+
+    this->frequency = obtained.freq;
+    this->bufferSamples = obtained.samples;
+
+    SDL_PauseAudioDevice(device, 0);
+}
+
+AudioLayer::~AudioLayer()
+{
+    if (device != 0)
+    {
+        SDL_CloseAudioDevice(device);
+    }
+
+    if (subsystemStarted)
+    {
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+}
+
+bool AudioLayer::IsOpen() const
+{
+    return device != 0;
+}
+
+void AudioLayer::SetBeep(bool enabled)
+{
+    if (beep.load(std::memory_order_relaxed) != enabled)
+    {
+        beepChangeTime.store(Now(), std::memory_order_relaxed);
+        beep.store(enabled, std::memory_order_release);
+    }
+}
+
+void AudioLayer::SetPattern(const unsigned char* pattern, unsigned char pitch)
+{
+    unsigned long long high = 0;
+    unsigned long long low = 0;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        high = (high << 8u) | pattern[i];
+        low = (low << 8u) | pattern[i + 8];
+    }
+
+    // Halves and pitch may be observed from different updates for one buffer, that's inaudible and keeps the callback lock free.
+    patternHigh.store(high, std::memory_order_relaxed);
+    patternLow.store(low, std::memory_order_relaxed);
+    this->pitch.store(pitch, std::memory_order_relaxed);
+}
+
+float AudioLayer::GetBufferLatency() const
+{
+    return frequency > 0 ? 1000.0f * bufferSamples / frequency : 0.0f;
+}
+
+float AudioLayer::GetMeasuredLatency() const
+{
+    return measuredLatency.load(std::memory_order_relaxed);
+}
+
+void AudioLayer::Callback(void* userData, unsigned char* stream, int length)
+{
+    static_cast<AudioLayer*>(userData)->Fill(reinterpret_cast<short*>(stream), length / static_cast<int>(sizeof(short)));
+}
+
+void AudioLayer::Fill(short* samples, int count)
+{
+    const bool enabled = beep.load(std::memory_order_acquire);
+    if (enabled != lastBeep)
+    {
+        lastBeep = enabled;
+        const float pickupTime = (Now() - beepChangeTime.load(std::memory_order_relaxed)) / 1000000.0f;
+        measuredLatency.store(pickupTime + GetBufferLatency(), std::memory_order_relaxed);
+    }
+
+    if (!enabled)
+    {
+        phase = 0.0;
+        for (int i = 0; i < count; ++i)
+        {
+            samples[i] = 0;
+        }
+        return;
+    }
+
+    const unsigned long long high = patternHigh.load(std::memory_order_relaxed);
+    const unsigned long long low = patternLow.load(std::memory_order_relaxed);
+    const double rate = 4000.0 * std::pow(2.0, (pitch.load(std::memory_order_relaxed) - 64) / 48.0); // XO-CHIP playback rate.
+    const double step = rate / frequency;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const unsigned int bit = static_cast<unsigned int>(phase);
+        const unsigned long long half = bit < 64 ? high : low;
+        const bool on = (half >> (63u - bit % 64u)) & 1u;
+        samples[i] = on ? Amplitude : -Amplitude;
+
+        phase += step;
+        if (phase >= PatternBits)
+        {
+            phase -= PatternBits;
+        }
+    }
+}
+
+} // namespace Chip8Emu
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+
+namespace Chip8Emu
+{
+
+constexpr int MinAudioBufferSamples = 64;   // ~1.3ms at 48kHz, smaller buffers underrun on most drivers.
+constexpr int MaxAudioBufferSamples = 8192; // SDL_AudioSpec::samples is 16 bit.
+
+// Responsible for the sound output, initializes SDL audio subsystem on its own.
+// If there is no audio driver or device, IsOpen() returns false and the rest of the emulator works as usual.
+// Emulation thread only publishes the state through atomics, SDL audio callback reads it without any locks.
+class AudioLayer final
+{
+public:
+    // Smaller buffer == lower latency, but higher chance of underruns.
+    // bufferSamples is clamped into [MinAudioBufferSamples, MaxAudioBufferSamples] and rounded up to power of two.
+    AudioLayer(int bufferSamples = 256, int frequency = 48000);
+    ~AudioLayer();
+
+    AudioLayer(const AudioLayer&) = delete;
+    AudioLayer& operator=(const AudioLayer&) = delete;
+
+    bool IsOpen() const;
+
+    void SetBeep(bool enabled); // Usually soundTimer > 0.
+    void SetPattern(const unsigned char* pattern, unsigned char pitch); // XO-CHIP pattern, AudioPatternSize bytes.
+
+    float GetBufferLatency() const; // Milliseconds, size of the buffer obtained from the device.
+    float GetMeasuredLatency() const; // Milliseconds, from the last beep change till the first sample of it is queued + buffer latency.
+
+private:
+    static void Callback(void* userData, unsigned char* stream, int length);
+    void Fill(short* samples, int count);
+
+private:
+    unsigned int device = 0; // SDL_AudioDeviceID.
+    bool subsystemStarted = false;
+    int frequency = 0;
+    int bufferSamples = 0;
+
+    std::atomic<bool> beep{false};
+    std::atomic<long long> beepChangeTime{0}; // Nanoseconds, steady clock.
+    std::atomic<unsigned long long> patternHigh{0}; // Bytes 0..7 of the pattern, first sample is the most significant bit.
+    std::atomic<unsigned long long> patternLow{0};  // Bytes 8..15 of the pattern.
+    std::atomic<unsigned char> pitch{0};
+    std::atomic<float> measuredLatency{0.0f};
+
+    // Audio thread only.
+    bool lastBeep = false;
+    double phase = 0.0; // Position inside of the 128 samples pattern.
+};
+
+} // namespace Chip8Emu
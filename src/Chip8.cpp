@@ -1,10 +1,8 @@
 #include "Chip8.h"
 
 #include <fstream>
-#include <vector>
 #include <cstring>
 #include <chrono>
-#include <random>
 #include <algorithm>
 
 namespace Chip8Emu
@@ -12,6 +10,43 @@ namespace Chip8Emu
 
 constexpr unsigned int FontsetStartAddress = 0x50;
 
+namespace
+{
+
+bool UpdateBit(unsigned long long* bitmap, unsigned short address, bool enabled) // Returns true if the bit has changed.
+{
+    unsigned long long& word = bitmap[(address & AddressMask) / 64];
+    const unsigned long long bit = 1ull << (address % 64);
+    const bool wasEnabled = (word & bit) != 0;
+
+    word = enabled ? (word | bit) : (word & ~bit);
+    return wasEnabled != enabled;
+}
+
+bool TestBit(const unsigned long long* bitmap, unsigned int address)
+{
+    return (bitmap[(address & AddressMask) / 64] >> (address % 64)) & 1ull;
+}
+
+} // namespace
+
+const char* ToString(LoadError error)
+{
+    switch (error)
+    {
+    case LoadError::None:
+        return "no error";
+    case LoadError::OpenFailed:
+        return "can't open the file";
+    case LoadError::ReadFailed:
+        return "can't read the file";
+    case LoadError::TooLarge:
+        return "ROM doesn't fit into the memory";
+    }
+
+    return "unknown error";
+}
+
 Chip8::Chip8()
 {
     constexpr unsigned int FontsetSize = 80; // 16 symbols x 5 bytes long
@@ -38,6 +73,14 @@ Chip8::Chip8()
     // Load fonts into the memory
     std::memcpy(memory + FontsetStartAddress, fontset, FontsetSize);
 
+    Seed(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()));
+
+    // Default audio pattern is 250Hz square wave at the default pitch, so plain Chip8 ROMs get the usual beep.
+    for (unsigned int i = 0; i < AudioPatternSize; ++i)
+    {
+        audioPattern[i] = (i % 2) ? 0x00u : 0xFFu;
+    }
+
     // Define function pointer table
     table[0x0] = &Chip8::Table0;
     table[0x1] = &Chip8::Op1nnn;
@@ -56,11 +99,11 @@ Chip8::Chip8()
     table[0xE] = &Chip8::TableE;
     table[0xF] = &Chip8::TableF;
 
-    std::fill_n(table0, 0xF, &Chip8::OpNull);
+    std::fill_n(table0, 0xF + 1, &Chip8::OpNull);
     table0[0x0] = &Chip8::Op00E0;
     table0[0xE] = &Chip8::Op00EE;
 
-    std::fill_n(table8, 0xF, &Chip8::OpNull);
+    std::fill_n(table8, 0xF + 1, &Chip8::OpNull);
     table8[0x0] = &Chip8::Op8xy0;
     table8[0x1] = &Chip8::Op8xy1;
     table8[0x2] = &Chip8::Op8xy2;
@@ -71,11 +114,12 @@ Chip8::Chip8()
     table8[0x7] = &Chip8::Op8xy7;
     table8[0xE] = &Chip8::Op8xyE;
 
-    std::fill_n(tableE, 0xF, &Chip8::OpNull);
+    std::fill_n(tableE, 0xF + 1, &Chip8::OpNull);
     tableE[0x1] = &Chip8::OpExA1;
     tableE[0xE] = &Chip8::OpEx9E;
 
-    std::fill_n(tableF, 0x66, &Chip8::OpNull);
+    std::fill_n(tableF, 0xFF + 1, &Chip8::OpNull);
+    tableF[0x02] = &Chip8::OpF002;
     tableF[0x07] = &Chip8::OpFx07;
     tableF[0x0A] = &Chip8::OpFx0A;
     tableF[0x15] = &Chip8::OpFx15;
@@ -83,32 +127,81 @@ Chip8::Chip8()
     tableF[0x1E] = &Chip8::OpFx1E;
     tableF[0x29] = &Chip8::OpFx29;
     tableF[0x33] = &Chip8::OpFx33;
+    tableF[0x3A] = &Chip8::OpFx3A;
     tableF[0x55] = &Chip8::OpFx55;
     tableF[0x65] = &Chip8::OpFx65;
 }
 
-void Chip8::LoadROM(const char* filename)
+LoadError Chip8::LoadROM(const char* filename)
 {
     std::ifstream file(filename, std::ios::binary | std::ios::ate); // Move file pointer to the end of stream to get the ROM size;
     if (!file.is_open())
     {
-        return;
+        return LoadError::OpenFailed;
     }
 
     const std::streampos size = file.tellg();
-    std::vector<char> romBuffer;
-    romBuffer.resize(size);
+    if (size < 0)
+    {
+        return LoadError::ReadFailed;
+    }
+
+    if (static_cast<unsigned long long>(size) > MemorySize - StartAddress)
+    {
+        return LoadError::TooLarge;
+    }
 
+    // Read straight into the memory, no intermediate buffer.
     file.seekg(0, std::ios::beg);
-    file.read(romBuffer.data(), size);
-    file.close();
+    file.read(reinterpret_cast<char*>(memory + StartAddress), size);
+    if (!file)
+    {
+        // Partial read already overwrote the program area, leave it clean instead of the mix of two ROMs.
+        std::memset(memory + StartAddress, 0, MemorySize - StartAddress);
+        dirtyMemory = ~0ull;
+        return LoadError::ReadFailed;
+    }
 
-    std::memcpy(memory + StartAddress, romBuffer.data(), size);
+    std::memset(memory + StartAddress + size, 0, MemorySize - StartAddress - size);
+    dirtyMemory = ~0ull;
+    return LoadError::None;
+}
+
+LoadError Chip8::LoadROM(const unsigned char* data, std::size_t size)
+{
+    if (size > MemorySize - StartAddress)
+    {
+        return LoadError::TooLarge;
+    }
+
+    std::memcpy(memory + StartAddress, data, size);
+    std::memset(memory + StartAddress + size, 0, MemorySize - StartAddress - size);
+    dirtyMemory = ~0ull;
+    return LoadError::None;
 }
 
 void Chip8::Cycle()
 {
-    opcode = (memory[pc] << 8u) | memory[pc + 1];
+    if (debugArmed && !DebugCanExecute())
+    {
+        return;
+    }
+
+#if CHIP8_CHECKED_MEMORY
+    if (fault != Fault::None)
+    {
+        return; // Machine is stopped until it's recreated.
+    }
+#endif
+
+    instructionAddress = pc; // pc moves past the instruction before it's executed.
+    opcode = (MemoryAt(pc) << 8u) | MemoryAt(pc, 1);
+#if CHIP8_CHECKED_MEMORY
+    if (fault != Fault::None)
+    {
+        return;
+    }
+#endif
     pc += 2;
 
     (this->*(table[(opcode & 0xF000u) >> 12u]))();
@@ -134,15 +227,315 @@ const unsigned int* Chip8::GetVideoMemory() const
     return videoMemory;
 }
 
+unsigned char Chip8::GetSoundTimer() const
+{
+    return soundTimer;
+}
+
+const unsigned char* Chip8::GetAudioPattern() const
+{
+    return audioPattern;
+}
+
+unsigned char Chip8::GetPitch() const
+{
+    return pitch;
+}
+
+unsigned char* Chip8::GetRegisters()
+{
+    return registers;
+}
+
+unsigned char* Chip8::GetMemory()
+{
+    return memory;
+}
+
+const unsigned short* Chip8::GetStack() const
+{
+    return stack;
+}
+
+unsigned char Chip8::GetStackPointer() const
+{
+    return sp;
+}
+
+unsigned short Chip8::GetIndex() const
+{
+    return index;
+}
+
+void Chip8::SetIndex(unsigned short value)
+{
+    index = value;
+}
+
+unsigned short Chip8::GetProgramCounter() const
+{
+    return pc;
+}
+
+void Chip8::SetProgramCounter(unsigned short value)
+{
+    pc = value;
+}
+
+unsigned char Chip8::GetDelayTimer() const
+{
+    return delayTimer;
+}
+
+void Chip8::SaveState(Chip8State& state) const
+{
+    std::memcpy(state.memory, memory, sizeof(state.memory));
+    std::memcpy(state.videoMemory, videoMemory, sizeof(videoMemory));
+    SaveCpuState(state);
+}
+
+void Chip8::SaveCpuState(Chip8State& state) const
+{
+    std::memcpy(state.registers, registers, sizeof(registers));
+    std::memcpy(state.memoryGuard, memory + MemorySize, sizeof(state.memoryGuard));
+    state.sp = sp;
+    state.delayTimer = delayTimer;
+    state.soundTimer = soundTimer;
+    std::memcpy(state.keypad, keypad, sizeof(keypad));
+    state.index = index;
+    state.pc = pc;
+    std::memcpy(state.stack, stack, sizeof(stack));
+    std::memcpy(state.audioPattern, audioPattern, sizeof(audioPattern));
+    state.pitch = pitch;
+    state.fault = fault;
+    state.faultAddress = faultAddress;
+    state.randGen = randGen;
+    state.randomSeed = randomSeed;
+    state.randomDraws = randomDraws;
+}
+
+void Chip8::LoadState(const Chip8State& state)
+{
+    std::memcpy(registers, state.registers, sizeof(registers));
+    std::memcpy(memory, state.memory, sizeof(state.memory));
+    std::memcpy(memory + MemorySize, state.memoryGuard, sizeof(state.memoryGuard));
+    sp = state.sp;
+    delayTimer = state.delayTimer;
+    soundTimer = state.soundTimer;
+    std::memcpy(keypad, state.keypad, sizeof(keypad));
+    index = state.index;
+    pc = state.pc;
+    std::memcpy(stack, state.stack, sizeof(stack));
+    std::memcpy(videoMemory, state.videoMemory, sizeof(videoMemory));
+    std::memcpy(audioPattern, state.audioPattern, sizeof(audioPattern));
+    pitch = state.pitch;
+    fault = state.fault;
+    faultAddress = state.faultAddress;
+    randGen = state.randGen;
+    randomSeed = state.randomSeed;
+    randomDraws = state.randomDraws;
+    dirtyMemory = ~0ull;
+    dirtyVideo = true;
+}
+
+void Chip8::Seed(unsigned int seed)
+{
+    randGen.seed(seed);
+    randomSeed = seed;
+    randomDraws = 0;
+}
+
+unsigned long long Chip8::TakeDirtyMemory()
+{
+    const unsigned long long dirty = dirtyMemory;
+    dirtyMemory = 0;
+    return dirty;
+}
+
+bool Chip8::TakeDirtyVideo()
+{
+    const bool dirty = dirtyVideo;
+    dirtyVideo = false;
+    return dirty;
+}
+
+void Chip8::SetBreakpoint(unsigned short address, bool enabled)
+{
+    if (UpdateBit(breakpoints, address, enabled))
+    {
+        enabled ? ++breakpointCount : --breakpointCount;
+        UpdateDebugArmed();
+    }
+}
+
+void Chip8::SetWatchpoint(unsigned short address, bool enabled)
+{
+    if (UpdateBit(watchpoints, address, enabled))
+    {
+        enabled ? ++watchpointCount : --watchpointCount;
+        UpdateDebugArmed();
+    }
+}
+
+void Chip8::Interrupt()
+{
+    if (stopReason == StopReason::None)
+    {
+        stopReason = StopReason::Interrupt;
+    }
+    UpdateDebugArmed();
+}
+
+void Chip8::Resume()
+{
+    stopReason = StopReason::None;
+    skipBreakpoint = true; // Otherwise we would stop at the same breakpoint again.
+    UpdateDebugArmed();
+}
+
+void Chip8::Step()
+{
+    Resume();
+    Cycle();
+    if (stopReason == StopReason::None) // Watchpoint or fault have the priority.
+    {
+        stopReason = StopReason::Step;
+    }
+    UpdateDebugArmed();
+}
+
+StopReason Chip8::GetStopReason() const
+{
+    return stopReason;
+}
+
+unsigned short Chip8::GetWatchAddress() const
+{
+    return watchAddress;
+}
+
+bool Chip8::DebugCanExecute()
+{
+    if (stopReason != StopReason::None)
+    {
+        return false;
+    }
+
+    if (skipBreakpoint)
+    {
+        skipBreakpoint = false;
+        UpdateDebugArmed();
+        return true;
+    }
+
+    if (breakpointCount > 0 && TestBit(breakpoints, pc))
+    {
+        stopReason = StopReason::Breakpoint;
+        return false;
+    }
+
+    return true;
+}
+
+void Chip8::DebugOnWrite(unsigned int address)
+{
+    if (watchpointCount > 0 && address < MemorySize && TestBit(watchpoints, address))
+    {
+        stopReason = StopReason::Watchpoint; // Instruction is finished, the machine stops before the next one.
+        watchAddress = address;
+    }
+}
+
+void Chip8::UpdateDebugArmed()
+{
+    debugArmed = breakpointCount > 0 || watchpointCount > 0 || skipBreakpoint || stopReason != StopReason::None;
+}
+
+Fault Chip8::GetFault() const
+{
+    return fault;
+}
+
+unsigned short Chip8::GetFaultAddress() const
+{
+    return faultAddress;
+}
+
+unsigned char& Chip8::MemoryAt(unsigned int base, unsigned int offset)
+{
+#if CHIP8_CHECKED_MEMORY
+    const unsigned int address = base + offset;
+    if (address >= MemorySize)
+    {
+        RaiseFault(Fault::MemoryOutOfBounds);
+        return memory[MemorySize]; // Faulted accesses go to the guard area, so the instruction can finish harmlessly.
+    }
+
+    return memory[address];
+#else
+    return memory[(base & AddressMask) + offset]; // offset is always less than MemoryGuardSize.
+#endif
+}
+
+unsigned char Chip8::KeyAt(unsigned char key)
+{
+#if CHIP8_CHECKED_MEMORY
+    if (key >= KeyCount)
+    {
+        RaiseFault(Fault::InvalidKey);
+        return 0;
+    }
+
+    return keypad[key];
+#else
+    return keypad[key & (KeyCount - 1)];
+#endif
+}
+
+void Chip8::WriteMemory(unsigned int base, unsigned int offset, unsigned char value)
+{
+    unsigned char& cell = MemoryAt(base, offset);
+    cell = value;
+
+    const unsigned int address = static_cast<unsigned int>(&cell - memory);
+    if (address < MemorySize) // Guard area is not a part of the machine state.
+    {
+        dirtyMemory |= 1ull << (address / MemoryChunkSize);
+    }
+
+    if (debugArmed)
+    {
+        DebugOnWrite(address);
+    }
+}
+
+void Chip8::RaiseFault(Fault reason)
+{
+    if (fault == Fault::None) // Keep the first fault only.
+    {
+        fault = reason;
+        faultAddress = instructionAddress;
+    }
+}
+
 void Chip8::Op00E0() 
 {
     memset(videoMemory, 0, sizeof(videoMemory));
+    dirtyVideo = true;
 }
 
 void Chip8::Op00EE()
 {
+#if CHIP8_CHECKED_MEMORY
+    if (sp == 0)
+    {
+        RaiseFault(Fault::StackUnderflow);
+        return;
+    }
+#endif
+
     --sp;
-    pc = stack[sp];
+    pc = stack[sp & (StackSize - 1)];
 }
 
 void Chip8::Op1nnn()
@@ -154,7 +547,15 @@ void Chip8::Op1nnn()
 void Chip8::Op2nnn()
 {
     const unsigned short address = opcode & 0x0FFFu;
-    stack[sp] = pc;
+#if CHIP8_CHECKED_MEMORY
+    if (sp >= StackSize)
+    {
+        RaiseFault(Fault::StackOverflow);
+        return;
+    }
+#endif
+
+    stack[sp & (StackSize - 1)] = pc;
     ++sp;
     pc = address;
 }
@@ -322,10 +723,10 @@ void Chip8::OpCxkk()
     const unsigned char Vx = (opcode & 0x0F00u) >> 8u;
     const unsigned char byte = opcode & 0x00FFu;
 
-    static std::default_random_engine randGen(std::chrono::system_clock::now().time_since_epoch().count());
-	static std::uniform_int_distribution<uint8_t> randByte(0, 255u);
+    std::uniform_int_distribution<unsigned int> randByte(0, 255u);
 
     registers[Vx] = randByte(randGen) & byte;
+    ++randomDraws;
 }
 
 void Chip8::OpDxyn()
@@ -338,10 +739,11 @@ void Chip8::OpDxyn()
     const unsigned char yPos = registers[Vy] % VideoHeight;
 
     registers[0xF] = 0; // nullify flag register before checking for collisions.
+    dirtyVideo = true;
 
     for (unsigned int row = 0; row < height; ++row)
     {
-        const unsigned char spriteByte = memory[index + row];
+        const unsigned char spriteByte = MemoryAt(index, row);
         const unsigned char wrappedYPos = (yPos + row) % VideoHeight; // Wrap sprite around the corner if reaches the end.
         for (unsigned int column = 0; column < 8; ++column)
         {
@@ -365,7 +767,7 @@ void Chip8::OpEx9E()
 {
     const unsigned char Vx = (opcode & 0x0F00u) >> 8u;
     const unsigned char key = registers[Vx];
-    if (keypad[key])
+    if (KeyAt(key))
     {
         pc += 2;
     }
@@ -375,7 +777,7 @@ void Chip8::OpExA1()
 {
     const unsigned char Vx = (opcode & 0x0F00u) >> 8u;
     const unsigned char key = registers[Vx];
-    if (!keypad[key])
+    if (!KeyAt(key))
     {
         pc += 2;
     }
@@ -459,13 +861,13 @@ void Chip8::OpFx33()
     const unsigned char Vx = (opcode & 0x0F00u) >> 8u;
     unsigned char value = registers[Vx];
 
-    memory[index + 2] = value % 10;
+    WriteMemory(index, 2, value % 10);
     value /= 10;
 
-    memory[index + 1] = value % 10;
+    WriteMemory(index, 1, value % 10);
     value /= 10;
 
-    memory[index] = value % 10;
+    WriteMemory(index, 0, value % 10);
 }
 
 void Chip8::OpFx55()
@@ -473,7 +875,7 @@ void Chip8::OpFx55()
     const unsigned short Vx = (opcode & 0x0F00u) >> 8u;
     for (unsigned short i = 0; i <= Vx; ++i)
     {
-        memory[index + i] = registers[i];
+        WriteMemory(index, i, registers[i]);
     }
 }
 
@@ -482,10 +884,30 @@ void Chip8::OpFx65()
     const unsigned short Vx = (opcode & 0x0F00u) >> 8u;
     for (unsigned short i = 0; i <= Vx; ++i)
     {
-        registers[i] = memory[index + i];
+        registers[i] = MemoryAt(index, i);
     }
 }
 
+void Chip8::OpF002()
+{
+    if ((opcode & 0x0F00u) != 0) // Only F002 is defined, Fx02 is the same as any other unknown opcode.
+    {
+        OpNull();
+        return;
+    }
+
+    for (unsigned short i = 0; i < AudioPatternSize; ++i)
+    {
+        audioPattern[i] = MemoryAt(index, i);
+    }
+}
+
+void Chip8::OpFx3A()
+{
+    const unsigned char Vx = (opcode & 0x0F00u) >> 8u;
+    pitch = registers[Vx];
+}
+
 void Chip8::Table0()
 {
     (this->*(table0[opcode & 0x000Fu]))();
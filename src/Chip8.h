@@ -1,13 +1,82 @@
 #pragma once
 
+#include <cstddef>
+#include <random>
+
+// Memory access policy, selected at compile time (see Makefile ACCESS_POLICY):
+// 1 - checked: every address is validated, out of bounds accesses are reported through GetFault() and stop the machine.
+// 0 - unchecked: addresses are masked to 12 bits and small offsets land into the guard area, no branches on the fast path.
+#ifndef CHIP8_CHECKED_MEMORY
+#define CHIP8_CHECKED_MEMORY 1
+#endif
+
 namespace Chip8Emu
 {
 
 constexpr unsigned int StartAddress = 0x200; // Usable memory address starts only from 0x200.
 constexpr unsigned int MemorySize = 4096;
+constexpr unsigned int MemoryGuardSize = 16; // Largest offset from a base address is 15 (Dxyn rows, Fx55/Fx65 registers).
+constexpr unsigned int AddressMask = MemorySize - 1;
+constexpr unsigned int MemoryChunkSize = 64; // Granularity of the memory write tracking.
+constexpr unsigned int MemoryChunkCount = MemorySize / MemoryChunkSize; // Fits into one 64 bit mask.
+constexpr unsigned int StackSize = 16;
+constexpr unsigned int KeyCount = 16;
+constexpr unsigned int AudioPatternSize = 16; // XO-CHIP 1 bit audio pattern, 128 samples.
+constexpr unsigned char DefaultPitch = 64; // Pattern playback rate of 4000 samples per second.
 constexpr unsigned char VideoWidth = 64u;
 constexpr unsigned char VideoHeight = 32u;
 
+enum class Fault : unsigned char
+{
+    None,
+    MemoryOutOfBounds, // Read or write outside of [0, MemorySize).
+    StackOverflow,     // Call with the full stack.
+    StackUnderflow,    // Return with the empty stack.
+    InvalidKey         // Key index in the register is bigger than 0xF.
+};
+
+enum class LoadError : unsigned char
+{
+    None,
+    OpenFailed, // File doesn't exist or can't be opened.
+    ReadFailed,
+    TooLarge    // ROM doesn't fit into the memory above StartAddress.
+};
+
+const char* ToString(LoadError error);
+
+enum class StopReason : unsigned char
+{
+    None,
+    Breakpoint, // Stopped before the instruction at the breakpoint address.
+    Watchpoint, // Stopped after the instruction which wrote into the watched address.
+    Step,       // Single instruction was executed.
+    Interrupt   // Stopped on request.
+};
+
+// Complete machine state, used to snapshot, restore and compare the machines.
+struct Chip8State
+{
+    unsigned char registers[16]{};
+    unsigned char memory[MemorySize]{};
+    unsigned char memoryGuard[MemoryGuardSize]{}; // Unchecked policy writes past the end of the memory land here.
+    unsigned char sp = 0;
+    unsigned char delayTimer = 0;
+    unsigned char soundTimer = 0;
+    unsigned char keypad[KeyCount]{};
+    unsigned short index = 0;
+    unsigned short pc = StartAddress;
+    unsigned short stack[StackSize]{};
+    unsigned int videoMemory[VideoWidth * VideoHeight]{};
+    unsigned char audioPattern[AudioPatternSize]{};
+    unsigned char pitch = DefaultPitch;
+    Fault fault = Fault::None;
+    unsigned short faultAddress = 0;
+    std::default_random_engine randGen;
+    unsigned int randomSeed = 0;
+    unsigned long long randomDraws = 0; // Together with the seed identifies the state of randGen, its layout is implementation defined.
+};
+
 class Chip8 final
 {
 public:
@@ -18,11 +87,46 @@ public:
     Chip8& operator=(const Chip8&) = delete;
     Chip8& operator=(const Chip8&&) = delete;
 
-    void LoadROM(const char* filename);
+    LoadError LoadROM(const char* filename); // On ReadFailed the program area is cleared, other errors leave the memory untouched.
+    LoadError LoadROM(const unsigned char* data, std::size_t size); // Single copy into the memory, the rest of the program area is cleared.
     void Cycle();
 
     unsigned char* GetKeyPad();
     const unsigned int* GetVideoMemory() const;
+    unsigned char GetSoundTimer() const;
+    const unsigned char* GetAudioPattern() const; // AudioPatternSize bytes, square wave unless the ROM loaded its own one.
+    unsigned char GetPitch() const;
+    Fault GetFault() const; // Always Fault::None for the unchecked policy.
+    unsigned short GetFaultAddress() const; // Program counter of the faulted instruction.
+
+    // State inspection for the debugger, memory is MemorySize bytes long.
+    unsigned char* GetRegisters();
+    unsigned char* GetMemory();
+    const unsigned short* GetStack() const;
+    unsigned char GetStackPointer() const;
+    unsigned short GetIndex() const;
+    void SetIndex(unsigned short value);
+    unsigned short GetProgramCounter() const;
+    void SetProgramCounter(unsigned short value);
+    unsigned char GetDelayTimer() const;
+
+    // Snapshots. Debugging state (breakpoints, watchpoints, stop) is not a part of the machine state.
+    void SaveState(Chip8State& state) const;
+    void SaveCpuState(Chip8State& state) const; // Everything except of the memory and the video memory, which are the bulk of the copy.
+    void LoadState(const Chip8State& state);
+    void Seed(unsigned int seed); // Makes Cxkk deterministic, random device is seeded from the clock by default.
+    unsigned long long TakeDirtyMemory(); // Bit per memory chunk written since the last call (LoadState marks everything), clears the mask.
+    bool TakeDirtyVideo(); // True if 00E0 or Dxyn were executed since the last call (or LoadState), clears the flag.
+
+    // Debugging. Cycle() does nothing while the machine is stopped.
+    // Until any breakpoint or watchpoint is set, the only cost for Cycle() is the single flag check.
+    void SetBreakpoint(unsigned short address, bool enabled);
+    void SetWatchpoint(unsigned short address, bool enabled); // Watches writes from Fx33 and Fx55.
+    void Interrupt(); // Stop before the next instruction.
+    void Resume();    // Continue execution, the breakpoint at the current address is skipped once.
+    void Step();      // Execute exactly one instruction and stop.
+    StopReason GetStopReason() const;
+    unsigned short GetWatchAddress() const; // Address written by the instruction which triggered the watchpoint.
 
 private:
     // Instructions
@@ -60,6 +164,8 @@ private:
     void OpFx33(); // Takes the value from register Vx and places it into the memory in such way: stores hundreds at location "index", tens - "index + 1", digits - "Index + 2".
     void OpFx55(); // Stores the registers from V0 to Vx into the memory starting at location "index";
     void OpFx65(); // Loads the registers from V0 to Vx from the memory starting at location "index".
+    void OpF002(); // XO-CHIP: Load 16 bytes audio pattern from the memory starting at location "index".
+    void OpFx3A(); // XO-CHIP: Set the pitch of the audio pattern playback to the value of the register Vx.
     void OpNull(){} // Dummy instruction in case if the opcode is wrong.
 
     // Redirection tables
@@ -68,26 +174,56 @@ private:
     void TableE();
     void TableF();
 
+    // Memory access, behavior depends on the CHIP8_CHECKED_MEMORY policy.
+    unsigned char& MemoryAt(unsigned int base, unsigned int offset = 0);
+    unsigned char KeyAt(unsigned char key);
+    void WriteMemory(unsigned int base, unsigned int offset, unsigned char value);
+    void RaiseFault(Fault reason);
+
+    bool DebugCanExecute(); // Checks the stop state and the breakpoints before the instruction.
+    void DebugOnWrite(unsigned int address);
+    void UpdateDebugArmed();
+
 private:
     unsigned char registers[16]{};
-    unsigned char memory[MemorySize]{};
+    unsigned char memory[MemorySize + MemoryGuardSize]{}; // Guard area absorbs accesses past the end in the unchecked mode.
     unsigned char sp = 0; // Stack pointer;
     unsigned char delayTimer = 0;
     unsigned char soundTimer = 0;
-    unsigned char keypad[16]{};
+    unsigned char keypad[KeyCount]{};
     unsigned short index = 0;
     unsigned short pc = StartAddress; // Program counter
-    unsigned short stack[16]{};
+    unsigned short stack[StackSize]{};
     unsigned short opcode = 0;
+    unsigned short instructionAddress = StartAddress; // Address of the instruction being executed.
     unsigned int videoMemory[VideoWidth * VideoHeight]{};
+    unsigned char audioPattern[AudioPatternSize]{};
+    unsigned char pitch = DefaultPitch;
+    std::default_random_engine randGen;
+    unsigned int randomSeed = 0;
+    unsigned long long randomDraws = 0;
+    Fault fault = Fault::None;
+    unsigned short faultAddress = 0;
+    unsigned long long dirtyMemory = ~0ull;
+    bool dirtyVideo = true;
+
+    // Debugging state, bit per address.
+    unsigned long long breakpoints[MemorySize / 64]{};
+    unsigned long long watchpoints[MemorySize / 64]{};
+    unsigned int breakpointCount = 0;
+    unsigned int watchpointCount = 0;
+    bool debugArmed = false; // Any breakpoint, watchpoint or stop is active.
+    bool skipBreakpoint = false;
+    StopReason stopReason = StopReason::None;
+    unsigned short watchAddress = 0;
 
 // Instead of having huge switch, we are going to implement functio table, so the opcode could lead into the function (through the indirection though.).
 using Chip8Func = void(Chip8::*)();
     Chip8Func table[0xF + 1];
-    Chip8Func table0[0xF];
-    Chip8Func table8[0xF];
-    Chip8Func tableE[0xF];
-    Chip8Func tableF[0x66];
+    Chip8Func table0[0xF + 1];
+    Chip8Func table8[0xF + 1];
+    Chip8Func tableE[0xF + 1];
+    Chip8Func tableF[0xFF + 1];
 };
 
 } // namespace Chip8Emu
\ No newline at end of file
@@ -0,0 +1,510 @@
+#include "DebugServer.h"
+#include "Chip8.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace Chip8Emu
+{
+
+namespace
+{
+
+constexpr unsigned int RegisterCount = 16 + 5; // V0..VF, I, PC, SP, DT, ST.
+
+void SetNonBlocking(int socket)
+{
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+}
+
+void AppendHex(std::string& out, unsigned char byte)
+{
+    static const char digits[] = "0123456789abcdef";
+    out += digits[byte >> 4u];
+    out += digits[byte & 0xFu];
+}
+
+int HexDigit(char symbol)
+{
+    if (symbol >= '0' && symbol <= '9') return symbol - '0';
+    if (symbol >= 'a' && symbol <= 'f') return symbol - 'a' + 10;
+    if (symbol >= 'A' && symbol <= 'F') return symbol - 'A' + 10;
+    return -1;
+}
+
+// Parses two hex digits. Returns false if any of them is not a hex digit.
+bool ParseHexByte(const char* text, unsigned char& byte)
+{
+    const int high = HexDigit(text[0]);
+    const int low = high >= 0 ? HexDigit(text[1]) : -1;
+    if (low < 0)
+    {
+        return false;
+    }
+
+    byte = static_cast<unsigned char>(high * 16 + low);
+    return true;
+}
+
+// Parses the hex number, at least one digit is required. end points past the number.
+bool ParseHexNumber(const char* text, unsigned long& value, char*& end)
+{
+    if (HexDigit(text[0]) < 0) // strtoul would accept the sign and the spaces.
+    {
+        return false;
+    }
+
+    value = std::strtoul(text, &end, 16);
+    return true;
+}
+
+// Parses "addr,length" in hex. Returns false on the malformed input or if the range is outside of the memory.
+bool ParseRange(const std::string& text, unsigned long& address, unsigned long& length)
+{
+    char* end = nullptr;
+    if (!ParseHexNumber(text.c_str(), address, end) || *end != ',' || !ParseHexNumber(end + 1, length, end))
+    {
+        return false;
+    }
+
+    return address < MemorySize && length <= MemorySize - address; // Written this way to not overflow.
+}
+
+// Value of the register in the layout described in the header, width is in bytes.
+unsigned int ReadRegister(Chip8& chip8, unsigned int number, unsigned int& width)
+{
+    width = 1;
+    if (number < 16)
+    {
+        return chip8.GetRegisters()[number];
+    }
+
+    switch (number)
+    {
+    case 16: width = 2; return chip8.GetIndex();
+    case 17: width = 2; return chip8.GetProgramCounter();
+    case 18: return chip8.GetStackPointer();
+    case 19: return chip8.GetDelayTimer();
+    default: return chip8.GetSoundTimer();
+    }
+}
+
+} // namespace
+
+DebugServer::DebugServer(unsigned short port)
+{
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+    {
+        return;
+    }
+
+    const int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Never expose the machine outside of the host.
+
+    if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenSocket, 1) != 0)
+    {
+        close(listenSocket);
+        listenSocket = -1;
+        return;
+    }
+
+    SetNonBlocking(listenSocket);
+}
+
+DebugServer::~DebugServer()
+{
+    if (clientSocket >= 0)
+    {
+        close(clientSocket);
+    }
+
+    if (listenSocket >= 0)
+    {
+        close(listenSocket);
+    }
+}
+
+bool DebugServer::IsListening() const
+{
+    return listenSocket >= 0;
+}
+
+bool DebugServer::IsAttached() const
+{
+    return clientSocket >= 0;
+}
+
+void DebugServer::Poll(Chip8& chip8)
+{
+    if (listenSocket < 0)
+    {
+        return;
+    }
+
+    if (clientSocket < 0)
+    {
+        clientSocket = accept(listenSocket, nullptr, nullptr);
+        if (clientSocket < 0)
+        {
+            return;
+        }
+
+        SetNonBlocking(clientSocket);
+        const int noDelay = 1;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        input.clear();
+        running = false;
+        chip8.Interrupt(); // GDB expects the target to be stopped on attach.
+    }
+
+    char buffer[4096];
+    while (true)
+    {
+        const ssize_t received = recv(clientSocket, buffer, sizeof(buffer), 0);
+        if (received > 0)
+        {
+            input.append(buffer, received);
+            continue;
+        }
+
+        if (received == 0)
+        {
+            Disconnect(chip8);
+            return;
+        }
+
+        break; // EAGAIN, nothing more to read.
+    }
+
+    while (!input.empty())
+    {
+        if (input[0] == '\x03') // Ctrl+C from the client.
+        {
+            input.erase(0, 1);
+            chip8.Interrupt();
+            continue;
+        }
+
+        if (input[0] != '$') // Acks and garbage between the packets.
+        {
+            input.erase(0, 1);
+            continue;
+        }
+
+        const std::size_t end = input.find('#');
+        if (end == std::string::npos || end + 2 >= input.size())
+        {
+            break; // Packet is not complete yet.
+        }
+
+        const std::string packet = input.substr(1, end - 1);
+        input.erase(0, end + 3); // Checksum is not verified, TCP already takes care of the integrity.
+
+        send(clientSocket, "+", 1, MSG_NOSIGNAL);
+        HandlePacket(chip8, packet);
+        if (clientSocket < 0)
+        {
+            return;
+        }
+    }
+
+    if (running && (chip8.GetStopReason() != StopReason::None || chip8.GetFault() != Fault::None))
+    {
+        running = false;
+        SendStopReply(chip8);
+    }
+}
+
+void DebugServer::HandlePacket(Chip8& chip8, const std::string& packet)
+{
+    if (packet.empty())
+    {
+        SendPacket("");
+        return;
+    }
+
+    const char command = packet[0];
+    const std::string arguments = packet.substr(1);
+    switch (command)
+    {
+    case '?':
+        {
+            SendStopReply(chip8);
+            return;
+        }
+    case 'g':
+        {
+            std::string reply;
+            for (unsigned int number = 0; number < RegisterCount; ++number)
+            {
+                unsigned int width = 0;
+                const unsigned int value = ReadRegister(chip8, number, width);
+                for (unsigned int byte = 0; byte < width; ++byte)
+                {
+                    AppendHex(reply, (value >> (8u * byte)) & 0xFFu);
+                }
+            }
+            SendPacket(reply);
+            return;
+        }
+    case 'p':
+        {
+            unsigned long number = 0;
+            char* end = nullptr;
+            if (!ParseHexNumber(arguments.c_str(), number, end) || *end != '\0' || number >= RegisterCount)
+            {
+                SendPacket("E01");
+                return;
+            }
+
+            unsigned int width = 0;
+            const unsigned int value = ReadRegister(chip8, number, width);
+            std::string reply;
+            for (unsigned int byte = 0; byte < width; ++byte)
+            {
+                AppendHex(reply, (value >> (8u * byte)) & 0xFFu);
+            }
+            SendPacket(reply);
+            return;
+        }
+    case 'P':
+        {
+            // Only the general purpose registers, I and PC are writable.
+            char* end = nullptr;
+            unsigned long number = 0;
+            const std::size_t equals = arguments.find('=');
+            const std::size_t valueLength = equals == std::string::npos ? 0 : arguments.size() - equals - 1;
+            if (!ParseHexNumber(arguments.c_str(), number, end) || *end != '=' || valueLength == 0 || valueLength % 2 != 0 || valueLength > 4)
+            {
+                SendPacket("E01");
+                return;
+            }
+
+            unsigned int value = 0;
+            unsigned int shift = 0;
+            for (++end; *end; end += 2, shift += 8)
+            {
+                unsigned char byte = 0;
+                if (!ParseHexByte(end, byte))
+                {
+                    SendPacket("E01");
+                    return;
+                }
+
+                value |= static_cast<unsigned int>(byte) << shift;
+            }
+
+            if (number < 16)
+            {
+                chip8.GetRegisters()[number] = value & 0xFFu;
+            }
+            else if (number == 16)
+            {
+                chip8.SetIndex(value & 0xFFFFu);
+            }
+            else if (number == 17)
+            {
+                chip8.SetProgramCounter(value & 0xFFFFu);
+            }
+            else
+            {
+                SendPacket("E01");
+                return;
+            }
+            SendPacket("OK");
+            return;
+        }
+    case 'm':
+        {
+            unsigned long address = 0;
+            unsigned long length = 0;
+            if (!ParseRange(arguments, address, length))
+            {
+                SendPacket("E01");
+                return;
+            }
+
+            std::string reply;
+            for (unsigned long i = 0; i < length; ++i)
+            {
+                AppendHex(reply, chip8.GetMemory()[address + i]);
+            }
+            SendPacket(reply);
+            return;
+        }
+    case 'M':
+        {
+            unsigned long address = 0;
+            unsigned long length = 0;
+            const std::size_t colon = arguments.find(':');
+            if (colon == std::string::npos || !ParseRange(arguments.substr(0, colon), address, length) || arguments.size() - colon - 1 < length * 2)
+            {
+                SendPacket("E01");
+                return;
+            }
+
+            // Decode everything first, so the malformed packet doesn't leave the memory half written.
+            const char* data = arguments.c_str() + colon + 1;
+            std::vector<unsigned char> bytes(length);
+            for (unsigned long i = 0; i < length; ++i)
+            {
+                if (!ParseHexByte(data + 2 * i, bytes[i]))
+                {
+                    SendPacket("E01");
+                    return;
+                }
+            }
+
+            std::copy(bytes.begin(), bytes.end(), chip8.GetMemory() + address);
+            SendPacket("OK");
+            return;
+        }
+    case 'c':
+        {
+            chip8.Resume();
+            running = true; // Stop reply is sent from Poll() once the machine stops.
+            return;
+        }
+    case 's':
+        {
+            chip8.Step();
+            SendStopReply(chip8);
+            return;
+        }
+    case 'Z': // Intended fall through.
+    case 'z':
+        {
+            // Z<type>,<address>,<kind>
+            const bool enabled = command == 'Z';
+            const char type = arguments.empty() ? '?' : arguments[0];
+            unsigned long address = 0;
+            unsigned long length = 0;
+            if (arguments.size() < 2 || !ParseRange(arguments.substr(2), address, length))
+            {
+                SendPacket("E01");
+                return;
+            }
+
+            if (type == '0' || type == '1')
+            {
+                chip8.SetBreakpoint(static_cast<unsigned short>(address), enabled);
+            }
+            else if (type == '2')
+            {
+                for (unsigned long i = 0; i < (length ? length : 1); ++i)
+                {
+                    chip8.SetWatchpoint(static_cast<unsigned short>(address + i), enabled);
+                }
+            }
+            else
+            {
+                SendPacket(""); // Read and access watchpoints are not supported.
+                return;
+            }
+            SendPacket("OK");
+            return;
+        }
+    case 'D':
+        {
+            SendPacket("OK");
+            Disconnect(chip8);
+            return;
+        }
+    case 'k':
+        {
+            Disconnect(chip8);
+            return;
+        }
+    case 'q':
+        {
+            if (arguments.compare(0, 9, "Supported") == 0)
+            {
+                SendPacket("PacketSize=4000");
+            }
+            else if (arguments == "Chip8Stack")
+            {
+                std::string reply;
+                for (unsigned int i = 0; i < chip8.GetStackPointer() && i < StackSize; ++i)
+                {
+                    AppendHex(reply, chip8.GetStack()[i] & 0xFFu);
+                    AppendHex(reply, chip8.GetStack()[i] >> 8u);
+                }
+                SendPacket(reply);
+            }
+            else
+            {
+                SendPacket("");
+            }
+            return;
+        }
+    default:
+        {
+            SendPacket(""); // Empty reply means the packet is not supported.
+            return;
+        }
+    }
+}
+
+void DebugServer::SendPacket(const std::string& payload)
+{
+    if (clientSocket < 0)
+    {
+        return;
+    }
+
+    unsigned char checksum = 0;
+    for (const char symbol : payload)
+    {
+        checksum += static_cast<unsigned char>(symbol);
+    }
+
+    std::string packet = "$" + payload + "#";
+    AppendHex(packet, checksum);
+    send(clientSocket, packet.data(), packet.size(), MSG_NOSIGNAL);
+}
+
+void DebugServer::SendStopReply(const Chip8& chip8)
+{
+    if (chip8.GetFault() != Fault::None)
+    {
+        SendPacket("S0B"); // SIGSEGV, faulted machine doesn't execute anything anymore.
+        return;
+    }
+
+    if (chip8.GetStopReason() == StopReason::Watchpoint)
+    {
+        char reply[32];
+        std::snprintf(reply, sizeof(reply), "T05watch:%x;", chip8.GetWatchAddress());
+        SendPacket(reply);
+        return;
+    }
+
+    SendPacket(chip8.GetStopReason() == StopReason::Interrupt ? "S02" : "S05"); // SIGINT or SIGTRAP.
+}
+
+void DebugServer::Disconnect(Chip8& chip8)
+{
+    close(clientSocket);
+    clientSocket = -1;
+    input.clear();
+    running = false;
+    chip8.Resume(); // Don't leave the machine stopped without anybody to resume it.
+}
+
+} // namespace Chip8Emu
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+namespace Chip8Emu
+{
+
+class Chip8;
+
+// GDB remote serial protocol stub, listens on the localhost only.
+// Register layout for g/G/p/P packets: V0..VF (1 byte each), I (2 bytes), PC (2 bytes), SP, DT, ST (1 byte each), multibyte values are little endian.
+// Supported packets: ?, g, p, P, m, M, c, s, Z0/z0, Z1/z1 (breakpoints), Z2/z2 (write watchpoints), D, k, qSupported, qChip8Stack (hex of stack up to SP).
+class DebugServer final
+{
+public:
+    explicit DebugServer(unsigned short port);
+    ~DebugServer();
+
+    DebugServer(const DebugServer&) = delete;
+    DebugServer& operator=(const DebugServer&) = delete;
+
+    bool IsListening() const;
+    bool IsAttached() const;
+
+    // Non-blocking, call it from the emulation loop. Accepts the client, handles incoming packets and reports stops.
+    // Faults (checked memory policy) are reported as SIGSEGV stops.
+    void Poll(Chip8& chip8);
+
+private:
+    void HandlePacket(Chip8& chip8, const std::string& packet);
+    void SendPacket(const std::string& payload);
+    void SendStopReply(const Chip8& chip8);
+    void Disconnect(Chip8& chip8);
+
+private:
+    int listenSocket = -1;
+    int clientSocket = -1;
+    std::string input;
+    bool running = false; // Client resumed the machine and waits for the stop reply.
+};
+
+} // namespace Chip8Emu
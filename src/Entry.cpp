@@ -1,30 +1,79 @@
 #include "Chip8.h"
 #include "ApiLayer.h"
+#include "AudioLayer.h"
+#include "DebugServer.h"
+#include "FrameCapture.h"
 
 #include <iostream>
 #include <chrono>
+#include <cstring>
+#include <memory>
 
 int main(int argc, char* argv[])
 {
     if (argc < 2)
     {
-        std::cerr << "Usage: " << argv[0] << " ROMPath <Scale> <PrefferedFrameTime>(milliseconds)\n";
+        std::cerr << "Usage: " << argv[0] << " ROMPath <Scale> <PrefferedFrameTime>(milliseconds) <CapturePath>(.y4m or -) <AudioBufferSamples> <DebugPort>\n";
         return EXIT_FAILURE;
     }
 
     const char* romPath = argv[1];
     const int scale  = argc > 2 ? std::stoi(argv[2]) : 10;
     const float frameTime = argc > 3 ? std::stof(argv[3]) : 3;
+    const char* capturePath = argc > 4 && std::strcmp(argv[4], "-") != 0 ? argv[4] : nullptr;
+    const int audioBufferSamples = argc > 5 ? std::stoi(argv[5]) : 256;
+    const int debugPort = argc > 6 ? std::stoi(argv[6]) : 0;
+
+    if (audioBufferSamples < Chip8Emu::MinAudioBufferSamples || audioBufferSamples > Chip8Emu::MaxAudioBufferSamples)
+    {
+        std::cerr << "Audio buffer size has to be in range [" << Chip8Emu::MinAudioBufferSamples << ", " << Chip8Emu::MaxAudioBufferSamples << "] samples\n";
+        return EXIT_FAILURE;
+    }
 
     Chip8Emu::ApiLayer apiLayer("Chip8 Emulator", 
         Chip8Emu::VideoWidth * scale, Chip8Emu::VideoHeight * scale,
         Chip8Emu::VideoWidth, Chip8Emu::VideoHeight);
 
+    Chip8Emu::AudioLayer audioLayer(audioBufferSamples);
+    if (!audioLayer.IsOpen())
+    {
+        std::cerr << "Failed to open audio device, running without sound\n";
+    }
+
     Chip8Emu::Chip8 chip8;
-    chip8.LoadROM(romPath);
+    const Chip8Emu::LoadError loadError = chip8.LoadROM(romPath);
+    if (loadError != Chip8Emu::LoadError::None)
+    {
+        std::cerr << "Failed to load ROM " << romPath << ": " << Chip8Emu::ToString(loadError) << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<Chip8Emu::FrameCapture> capture;
+    if (capturePath)
+    {
+        const unsigned int framesPerSecond = frameTime > 0 ? static_cast<unsigned int>(1000.0f / frameTime + 0.5f) : 60u;
+        capture = std::make_unique<Chip8Emu::FrameCapture>(capturePath, framesPerSecond);
+        if (!capture->IsOpen())
+        {
+            std::cerr << "Failed to open capture file " << capturePath << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::unique_ptr<Chip8Emu::DebugServer> debugServer;
+    if (debugPort > 0)
+    {
+        debugServer = std::make_unique<Chip8Emu::DebugServer>(static_cast<unsigned short>(debugPort));
+        if (!debugServer->IsListening())
+        {
+            std::cerr << "Failed to listen for the debugger on port " << debugPort << '\n';
+            return EXIT_FAILURE;
+        }
+    }
 
     const int videoPitch = sizeof(chip8.GetVideoMemory()[0]) * Chip8Emu::VideoWidth;
 
+    bool faultReported = false;
     auto lastTime = std::chrono::high_resolution_clock::now();
     while (!apiLayer.ProcessInput(chip8.GetKeyPad()))
     {
@@ -33,11 +82,42 @@ int main(int argc, char* argv[])
         if (dt > frameTime)
         {
             lastTime = currentTime;
+            if (debugServer)
+            {
+                debugServer->Poll(chip8);
+            }
+
             chip8.Cycle();
+            if (chip8.GetFault() != Chip8Emu::Fault::None && !faultReported)
+            {
+                std::cerr << "Machine fault " << static_cast<int>(chip8.GetFault()) << " at address 0x" << std::hex << chip8.GetFaultAddress() << std::dec << '\n';
+                faultReported = true;
+            }
+
+            if (faultReported && !(debugServer && debugServer->IsAttached())) // Attached debugger gets the fault as a stop and inspects the machine.
+            {
+                return EXIT_FAILURE;
+            }
 
             apiLayer.Update(chip8.GetVideoMemory(), videoPitch);
+            audioLayer.SetPattern(chip8.GetAudioPattern(), chip8.GetPitch());
+            audioLayer.SetBeep(chip8.GetSoundTimer() > 0);
+            if (capture)
+            {
+                capture->Submit(chip8.GetVideoMemory());
+            }
         }
     }
+
+    if (audioLayer.IsOpen())
+    {
+        std::cout << "Audio latency: buffer " << audioLayer.GetBufferLatency() << "ms, measured " << audioLayer.GetMeasuredLatency() << "ms\n";
+    }
+
+    if (capture)
+    {
+        std::cout << "Captured " << capture->GetSubmittedCount() << " frames, dropped " << capture->GetDroppedCount() << '\n';
+    }
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "Explorer.h"
+#include "StateHash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace Chip8Emu
+{
+
+namespace
+{
+
+enum class Decision : unsigned char
+{
+    None,
+    KeyTest,   // Ex9E, ExA1.
+    KeyWait    // Fx0A.
+};
+
+Decision Decode(Chip8& chip8)
+{
+    const unsigned char* memory = chip8.GetMemory();
+    const unsigned short pc = chip8.GetProgramCounter() & AddressMask;
+    const unsigned char high = memory[pc];
+    const unsigned char low = memory[pc + 1]; // pc + 1 lands into the guard area at the end of the memory.
+
+    if ((high & 0xF0u) == 0xE0u && (low == 0x9Eu || low == 0xA1u))
+    {
+        return Decision::KeyTest;
+    }
+
+    if ((high & 0xF0u) == 0xF0u && low == 0x0Au)
+    {
+        return Decision::KeyWait;
+    }
+
+    return Decision::None;
+}
+
+} // namespace
+
+bool ConcurrentHashSet::Insert(unsigned long long hash)
+{
+    Shard& shard = shards[(hash >> 58u) % ShardCount]; // Low bits are used by the buckets of the set itself.
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.hashes.insert(hash).second;
+}
+
+std::size_t ConcurrentHashSet::Size() const
+{
+    std::size_t size = 0;
+    for (const Shard& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size += shard.hashes.size();
+    }
+
+    return size;
+}
+
+StateExplorer::StateExplorer(const ExplorerSettings& settings)
+    : settings(settings)
+{
+    if (this->settings.threads == 0)
+    {
+        this->settings.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+ExplorerReport StateExplorer::Explore(const Chip8State& start)
+{
+    ExplorerReport report;
+    std::vector<std::unique_ptr<Node>> frontier;
+
+    // Root: run from the snapshot till the first decision without branching.
+    {
+        WorkerContext context;
+        auto root = std::make_unique<Node>();
+        root->state = start;
+        for (unsigned int chunk = 0; chunk < MemoryChunkCount; ++chunk)
+        {
+            root->chunkHashes[chunk] = HashMemoryChunk(root->state.memory, chunk);
+            root->memoryHash += root->chunkHashes[chunk];
+        }
+
+        root->videoHash = HashVideo(root->state.videoMemory);
+
+        context.chip8->LoadState(start);
+        context.chip8->TakeDirtyMemory(); // Video stays dirty, so the frame at the end of the root segment is counted.
+        nextCapacity = static_cast<std::size_t>(settings.maxStates);
+        Record(*root, context, RunToDecision(context));
+
+        frontier = std::move(next);
+        next.clear();
+        report = context.report;
+    }
+
+    std::vector<WorkerContext> contexts(settings.threads);
+    unsigned long long expandedStates = 0;
+    for (unsigned int depth = 1; !frontier.empty() && depth <= settings.maxDepth && expandedStates < settings.maxStates; ++depth)
+    {
+        expandedStates += frontier.size(); // Never above maxStates, the previous level was admitted within the budget.
+        nextCapacity = static_cast<std::size_t>(settings.maxStates - expandedStates);
+        report.depth = depth;
+
+        std::atomic<std::size_t> cursor{0};
+        const auto work = [&](WorkerContext& context)
+        {
+            for (std::size_t i = cursor.fetch_add(1); i < frontier.size(); i = cursor.fetch_add(1))
+            {
+                Expand(*frontier[i], context);
+                frontier[i].reset(); // Snapshots are big, release them as soon as possible.
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int thread = 1; thread < settings.threads; ++thread)
+        {
+            workers.emplace_back(work, std::ref(contexts[thread]));
+        }
+        work(contexts[0]);
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        frontier = std::move(next);
+        next.clear();
+
+        // Threads finish in any order, the expansion order by the hash keeps the results reproducible.
+        std::sort(frontier.begin(), frontier.end(), HashLess);
+    }
+
+    for (const WorkerContext& context : contexts)
+    {
+        report.duplicateStates += context.report.duplicateStates;
+        report.decisions += context.report.decisions;
+        report.instructions += context.report.instructions;
+        report.coverage |= context.report.coverage;
+    }
+
+    report.uniqueStates = states.Size();
+    report.uniqueFrames = frames.Size();
+    return report;
+}
+
+void StateExplorer::Expand(const Node& node, WorkerContext& context)
+{
+    Chip8& chip8 = *context.chip8;
+    ++context.report.decisions;
+
+    chip8.LoadState(node.state);
+    const Decision decision = Decode(chip8);
+    const unsigned char Vx = node.state.memory[node.state.pc & AddressMask] & 0x0Fu;
+    const unsigned char key = node.state.registers[Vx];
+
+    // Ex9E/ExA1: key from Vx released or pressed. Fx0A: no key or the lowest pressed key is 0..F.
+    const unsigned int branches = decision == Decision::KeyTest ? 2 : KeyCount + 1;
+    for (unsigned int branch = 0; branch < branches; ++branch)
+    {
+        if (branch > 0)
+        {
+            chip8.LoadState(node.state);
+        }
+        // Only the changes after the node matter for the incremental hash.
+        chip8.TakeDirtyMemory();
+        chip8.TakeDirtyVideo();
+
+        unsigned char* keypad = chip8.GetKeyPad();
+        std::memset(keypad, 0, KeyCount);
+        if (branch > 0)
+        {
+            keypad[decision == Decision::KeyTest ? (key & (KeyCount - 1)) : branch - 1] = 1;
+        }
+
+        chip8.Cycle();
+        ++context.report.instructions;
+        std::memset(keypad, 0, KeyCount);
+
+        Record(node, context, RunToDecision(context));
+    }
+}
+
+bool StateExplorer::RunToDecision(WorkerContext& context)
+{
+    Chip8& chip8 = *context.chip8;
+    for (unsigned long long step = 0; step < settings.maxSegmentInstructions; ++step)
+    {
+        if (chip8.GetFault() != Fault::None)
+        {
+            return false;
+        }
+
+        context.report.coverage.set(chip8.GetProgramCounter() & AddressMask);
+        if (Decode(chip8) != Decision::None)
+        {
+            return true;
+        }
+
+        chip8.Cycle();
+        ++context.report.instructions;
+    }
+
+    return false;
+}
+
+void StateExplorer::Record(const Node& parent, WorkerContext& context, bool atDecision)
+{
+    Chip8& chip8 = *context.chip8;
+    Chip8State& state = *context.scratch;
+    chip8.SaveCpuState(state);
+
+    unsigned long long chunkHashes[MemoryChunkCount];
+    std::memcpy(chunkHashes, parent.chunkHashes, sizeof(chunkHashes));
+    unsigned long long memoryHash = parent.memoryHash;
+
+    const unsigned long long dirty = chip8.TakeDirtyMemory();
+    for (unsigned int chunk = 0; chunk < MemoryChunkCount; ++chunk)
+    {
+        if (!((dirty >> chunk) & 1ull))
+        {
+            continue;
+        }
+
+        const unsigned long long chunkHash = HashMemoryChunk(chip8.GetMemory(), chunk);
+        memoryHash += chunkHash - chunkHashes[chunk];
+        chunkHashes[chunk] = chunkHash;
+    }
+
+    unsigned long long videoHash = parent.videoHash;
+    if (chip8.TakeDirtyVideo())
+    {
+        videoHash = HashVideo(chip8.GetVideoMemory());
+        frames.Insert(videoHash);
+    }
+
+    const unsigned long long hash = CombineHashes(HashCpu(state), memoryHash, videoHash);
+    if (!states.Insert(hash))
+    {
+        ++context.report.duplicateStates;
+        return;
+    }
+
+    if (!atDecision)
+    {
+        return; // Fault or the path never asks for input again.
+    }
+
+    if (!Admits(hash))
+    {
+        return; // Over the budget, the state is still known and won't be counted again.
+    }
+
+    auto node = std::make_unique<Node>();
+    chip8.SaveState(node->state);
+    std::memcpy(node->chunkHashes, chunkHashes, sizeof(chunkHashes));
+    node->memoryHash = memoryHash;
+    node->videoHash = videoHash;
+    node->hash = hash;
+    Admit(std::move(node));
+}
+
+bool StateExplorer::HashLess(const std::unique_ptr<Node>& left, const std::unique_ptr<Node>& right)
+{
+    return left->hash < right->hash;
+}
+
+bool StateExplorer::Admits(unsigned long long hash)
+{
+    std::lock_guard<std::mutex> lock(nextMutex);
+    return next.size() < nextCapacity || (!next.empty() && hash < next.front()->hash);
+}
+
+void StateExplorer::Admit(std::unique_ptr<Node> node)
+{
+    // The snapshot is taken without the lock, so the heap could have changed since Admits().
+    std::lock_guard<std::mutex> lock(nextMutex);
+    if (next.size() < nextCapacity)
+    {
+        next.push_back(std::move(node));
+        std::push_heap(next.begin(), next.end(), HashLess);
+    }
+    else if (!next.empty() && node->hash < next.front()->hash)
+    {
+        std::pop_heap(next.begin(), next.end(), HashLess);
+        next.back() = std::move(node);
+        std::push_heap(next.begin(), next.end(), HashLess);
+    }
+}
+
+} // namespace Chip8Emu
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Chip8.h"
+
+#include <bitset>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace Chip8Emu
+{
+
+// Hash set split into independently locked shards, so worker threads rarely contend.
+class ConcurrentHashSet final
+{
+public:
+    bool Insert(unsigned long long hash); // Returns true if the hash wasn't there yet.
+    std::size_t Size() const;
+
+private:
+    static constexpr unsigned int ShardCount = 64;
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_set<unsigned long long> hashes;
+    };
+
+    Shard shards[ShardCount];
+};
+
+struct ExplorerSettings
+{
+    unsigned int threads = 0;                    // 0 - all hardware threads.
+    unsigned int maxDepth = 64;                  // Keypad decisions along one path.
+    unsigned long long maxStates = 20000;        // Unique states to expand, also bounds the snapshots kept for the next level.
+    unsigned long long maxSegmentInstructions = 100000; // Instructions between two decisions before the path is considered finished.
+};
+
+struct ExplorerReport
+{
+    unsigned long long uniqueStates = 0;
+    unsigned long long uniqueFrames = 0;
+    unsigned long long duplicateStates = 0; // Pruned branches.
+    unsigned long long decisions = 0;       // Expanded decision points.
+    unsigned long long instructions = 0;
+    unsigned int depth = 0;                 // Deepest explored decision level.
+    std::bitset<MemorySize> coverage;       // Addresses of the executed instructions.
+};
+
+// Explores the state space of the ROM by branching on the keypad at every Ex9E, ExA1 and Fx0A instruction.
+// Keypad combinations are branched by their equivalence classes: Ex9E/ExA1 see only the key in Vx (pressed or not),
+// Fx0A sees the lowest pressed key (none or one of 16), so every distinct outcome of every combination is covered.
+// Keys are released after the decision instruction, the next read is a decision on its own.
+// States are deduplicated by the hash. Memory hash is updated only for the chunks written since the parent state,
+// video hash only if anything was drawn, and the full snapshot is taken only for the new states to expand.
+// The next level keeps only the states with the smallest hashes that still fit into maxStates, so the cut doesn't
+// depend on the order the threads find them in and no more than maxStates snapshots are alive at once per level.
+class StateExplorer final
+{
+public:
+    explicit StateExplorer(const ExplorerSettings& settings);
+
+    ExplorerReport Explore(const Chip8State& start);
+
+private:
+    struct Node
+    {
+        Chip8State state;
+        unsigned long long chunkHashes[MemoryChunkCount]{};
+        unsigned long long memoryHash = 0;
+        unsigned long long videoHash = 0;
+        unsigned long long hash = 0; // Hash of the whole state.
+    };
+
+    struct WorkerContext
+    {
+        std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+        std::unique_ptr<Chip8State> scratch = std::make_unique<Chip8State>(); // Only the CPU part is used.
+        ExplorerReport report;
+    };
+
+    void Expand(const Node& node, WorkerContext& context);
+    bool RunToDecision(WorkerContext& context); // Returns true if the machine stopped before the decision instruction.
+    void Record(const Node& parent, WorkerContext& context, bool atDecision);
+    static bool HashLess(const std::unique_ptr<Node>& left, const std::unique_ptr<Node>& right);
+    bool Admits(unsigned long long hash); // Returns true if the state would get into the next level.
+    void Admit(std::unique_ptr<Node> node);
+
+private:
+    ExplorerSettings settings;
+    ConcurrentHashSet states;
+    ConcurrentHashSet frames;
+
+    std::mutex nextMutex;
+    std::vector<std::unique_ptr<Node>> next; // Max-heap by the hash, the largest one is evicted first.
+    std::size_t nextCapacity = 0;
+};
+
+} // namespace Chip8Emu
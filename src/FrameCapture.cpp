@@ -0,0 +1,141 @@
+#include "FrameCapture.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace Chip8Emu
+{
+
+FrameCapture::FrameCapture(const char* filename, unsigned int framesPerSecond, unsigned int queueCapacity)
+{
+    std::size_t capacity = 1;
+    while (capacity < queueCapacity)
+    {
+        capacity <<= 1;
+    }
+
+    ring.resize(capacity);
+    ringMask = capacity - 1;
+
+    file = std::fopen(filename, "wb");
+    if (!file)
+    {
+        return;
+    }
+
+    std::fprintf(file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 Cmono\n", VideoWidth, VideoHeight, framesPerSecond > 0 ? framesPerSecond : 60u);
+
+    running.store(true, std::memory_order_relaxed);
+    writer = std::thread(&FrameCapture::WriterLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    if (writer.joinable())
+    {
+        running.store(false, std::memory_order_release);
+        writer.join();
+    }
+
+    if (file)
+    {
+        std::fclose(file);
+    }
+}
+
+bool FrameCapture::IsOpen() const
+{
+    return file != nullptr;
+}
+
+void FrameCapture::Submit(const unsigned int* videoMemory)
+{
+    const unsigned long long frameIndex = nextIndex++;
+    if (!file)
+    {
+        return;
+    }
+
+    const std::size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead - tail.load(std::memory_order_acquire) > ringMask) // Ring is full, writer is behind.
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Frame& frame = ring[currentHead & ringMask];
+    frame.index = frameIndex;
+    for (unsigned int byte = 0; byte < PackedFrameSize; ++byte)
+    {
+        const unsigned int* pixels = videoMemory + byte * 8;
+        unsigned char packed = 0;
+        for (unsigned int bit = 0; bit < 8; ++bit)
+        {
+            packed = (packed << 1u) | (pixels[bit] != 0);
+        }
+
+        frame.pixels[byte] = packed;
+    }
+
+    head.store(currentHead + 1, std::memory_order_release);
+}
+
+unsigned long long FrameCapture::GetSubmittedCount() const
+{
+    return nextIndex;
+}
+
+unsigned long long FrameCapture::GetWrittenCount() const
+{
+    return written.load(std::memory_order_relaxed);
+}
+
+unsigned long long FrameCapture::GetDroppedCount() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void FrameCapture::WriterLoop()
+{
+    while (true)
+    {
+        // Read the flag before the head, so frames submitted before the stop are still flushed.
+        const bool keepRunning = running.load(std::memory_order_acquire);
+        const std::size_t currentHead = head.load(std::memory_order_acquire);
+        std::size_t currentTail = tail.load(std::memory_order_relaxed);
+
+        if (currentTail == currentHead)
+        {
+            if (!keepRunning)
+            {
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Nothing to do, don't burn the core.
+            continue;
+        }
+
+        for (; currentTail != currentHead; ++currentTail)
+        {
+            WriteFrame(ring[currentTail & ringMask]);
+            tail.store(currentTail + 1, std::memory_order_release); // Give the slot back as soon as possible.
+        }
+    }
+
+    std::fflush(file);
+}
+
+void FrameCapture::WriteFrame(const Frame& frame)
+{
+    unsigned char luma[VideoWidth * VideoHeight];
+    for (unsigned int i = 0; i < VideoWidth * VideoHeight; ++i)
+    {
+        luma[i] = (frame.pixels[i / 8] & (0x80u >> (i % 8))) ? 0xFFu : 0x00u;
+    }
+
+    std::fprintf(file, "FRAME XINDEX=%llu\n", frame.index);
+    std::fwrite(luma, 1, sizeof(luma), file);
+    written.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace Chip8Emu
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Chip8.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace Chip8Emu
+{
+
+constexpr unsigned int PackedFrameSize = VideoWidth * VideoHeight / 8; // 1 bit per pixel.
+
+// Records frames into lossless Y4M stream (monochrome, 8 bit luma) on the background thread.
+// Submit() is wait-free: the frame is packed into 1 bit per pixel and pushed into single producer/single consumer ring,
+// if the ring is full the frame is dropped and counted instead of stalling the emulation.
+class FrameCapture final
+{
+public:
+    FrameCapture(const char* filename, unsigned int framesPerSecond, unsigned int queueCapacity = 256); // queueCapacity is rounded up to power of two.
+    ~FrameCapture(); // Flushes queued frames and stops the writer.
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    bool IsOpen() const;
+    void Submit(const unsigned int* videoMemory); // Must be called from the single producer thread only.
+
+    unsigned long long GetSubmittedCount() const; // Index of the next frame == frames seen by the capture.
+    unsigned long long GetWrittenCount() const;
+    unsigned long long GetDroppedCount() const;
+
+private:
+    struct Frame
+    {
+        unsigned long long index = 0; // Stored in the frame header, gaps mean dropped frames.
+        unsigned char pixels[PackedFrameSize]{};
+    };
+
+    void WriterLoop();
+    void WriteFrame(const Frame& frame);
+
+private:
+    std::FILE* file = nullptr;
+    std::vector<Frame> ring;
+    std::size_t ringMask = 0;
+    unsigned long long nextIndex = 0; // Producer only.
+
+    alignas(64) std::atomic<std::size_t> head{0}; // Written by producer.
+    alignas(64) std::atomic<std::size_t> tail{0}; // Written by writer.
+    alignas(64) std::atomic<unsigned long long> written{0};
+    std::atomic<unsigned long long> dropped{0};
+    std::atomic<bool> running{false};
+
+    std::thread writer;
+};
+
+} // namespace Chip8Emu
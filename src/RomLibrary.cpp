@@ -0,0 +1,231 @@
+#include "RomLibrary.h"
+#include "StateHash.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+namespace Chip8Emu
+{
+
+namespace
+{
+
+// Heuristics over the opcodes at the even offsets, data between the instructions may give false positives.
+void Detect(RomEntry& entry)
+{
+    bool superChip = false;
+    bool xoChip = false;
+
+    for (std::size_t offset = 0; offset + 1 < entry.size; offset += 2)
+    {
+        const unsigned short opcode = (entry.data[offset] << 8u) | entry.data[offset + 1];
+        const unsigned char low = opcode & 0x00FFu;
+
+        switch (opcode >> 12u)
+        {
+        case 0x0:
+            {
+                if (opcode == 0x00FEu || opcode == 0x00FFu || opcode == 0x00FBu || opcode == 0x00FCu || opcode == 0x00FDu || (opcode & 0xFFF0u) == 0x00C0u)
+                {
+                    superChip = true;
+                }
+                else if ((opcode & 0xFFF0u) == 0x00D0u)
+                {
+                    xoChip = true; // Scroll up.
+                }
+                break;
+            }
+        case 0x5:
+            {
+                if ((opcode & 0x000Fu) == 0x2u || (opcode & 0x000Fu) == 0x3u)
+                {
+                    xoChip = true; // Save/load registers range.
+                }
+                break;
+            }
+        case 0x8:
+            {
+                if ((opcode & 0x000Fu) == 0x6u || (opcode & 0x000Fu) == 0xEu)
+                {
+                    entry.quirks |= QuirkShift;
+                }
+                break;
+            }
+        case 0xB:
+            {
+                entry.quirks |= QuirkJump;
+                break;
+            }
+        case 0xD:
+            {
+                entry.quirks |= QuirkClip;
+                if ((opcode & 0x000Fu) == 0x0u)
+                {
+                    superChip = true; // 16x16 sprite.
+                }
+                break;
+            }
+        case 0xF:
+            {
+                if (opcode == 0xF000u || opcode == 0xF002u || low == 0x01u || low == 0x3Au)
+                {
+                    xoChip = true;
+                }
+                else if (low == 0x30u || low == 0x75u || low == 0x85u)
+                {
+                    superChip = true;
+                }
+                else if (low == 0x55u || low == 0x65u)
+                {
+                    entry.quirks |= QuirkLoadStore;
+                }
+                break;
+            }
+        default:
+            break;
+        }
+    }
+
+    entry.variant = xoChip ? RomVariant::XoChip : (superChip ? RomVariant::SuperChip : RomVariant::Chip8);
+}
+
+} // namespace
+
+const char* ToString(RomVariant variant)
+{
+    switch (variant)
+    {
+    case RomVariant::Chip8:
+        return "CHIP-8";
+    case RomVariant::SuperChip:
+        return "SUPER-CHIP";
+    case RomVariant::XoChip:
+        return "XO-CHIP";
+    }
+
+    return "unknown";
+}
+
+RomLibrary::~RomLibrary()
+{
+    for (const RomEntry& entry : entries)
+    {
+        munmap(const_cast<unsigned char*>(entry.data), entry.size);
+    }
+}
+
+std::size_t RomLibrary::Scan(const char* directory)
+{
+    std::error_code error;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& file : std::filesystem::directory_iterator(directory, error))
+    {
+        if (file.is_regular_file(error))
+        {
+            paths.push_back(file.path());
+        }
+    }
+
+    if (error)
+    {
+        errors.push_back(std::string(directory) + ": " + error.message());
+    }
+
+    std::sort(paths.begin(), paths.end()); // Stable order of the entries between runs.
+
+    const std::size_t initialCount = entries.size();
+    for (const std::filesystem::path& path : paths)
+    {
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            errors.push_back(path.string() + ": " + std::strerror(errno));
+            continue;
+        }
+
+        struct stat info{};
+        if (fstat(file, &info) != 0 || info.st_size == 0)
+        {
+            errors.push_back(path.string() + ": empty or unreadable file");
+            close(file);
+            continue;
+        }
+
+        if (static_cast<unsigned long long>(info.st_size) > MemorySize - StartAddress)
+        {
+            errors.push_back(path.string() + ": " + ToString(LoadError::TooLarge)); // Not worth mapping and hashing.
+            close(file);
+            continue;
+        }
+
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        flags |= MAP_POPULATE; // Fault all pages in now, later loads shouldn't touch the disk.
+#endif
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, flags, file, 0);
+        close(file); // Mapping keeps its own reference.
+        if (mapping == MAP_FAILED)
+        {
+            errors.push_back(path.string() + ": " + std::strerror(errno));
+            continue;
+        }
+
+        RomEntry entry;
+        entry.path = path.string();
+        entry.data = static_cast<const unsigned char*>(mapping);
+        entry.size = static_cast<std::size_t>(info.st_size);
+        entry.hash = HashBytes(entry.data, entry.size);
+
+        const auto known = index.find(entry.hash);
+        if (known != index.end())
+        {
+            const RomEntry& indexed = entries[known->second];
+            if (indexed.size == entry.size && std::memcmp(indexed.data, entry.data, entry.size) == 0)
+            {
+                munmap(mapping, entry.size); // Same content under another name.
+                continue;
+            }
+
+            // Different content with the same hash can't be indexed, but it mustn't disappear silently either.
+            errors.push_back(entry.path + ": content hash collides with " + indexed.path);
+            munmap(mapping, entry.size);
+            continue;
+        }
+
+        Detect(entry);
+        index.emplace(entry.hash, entries.size());
+        entries.push_back(std::move(entry));
+    }
+
+    return entries.size() - initialCount;
+}
+
+const std::vector<RomEntry>& RomLibrary::GetEntries() const
+{
+    return entries;
+}
+
+const RomEntry* RomLibrary::Find(unsigned long long hash) const
+{
+    const auto found = index.find(hash);
+    return found != index.end() ? &entries[found->second] : nullptr;
+}
+
+const std::vector<std::string>& RomLibrary::GetErrors() const
+{
+    return errors;
+}
+
+LoadError RomLibrary::Load(const RomEntry& entry, Chip8& chip8)
+{
+    return chip8.LoadROM(entry.data, entry.size);
+}
+
+} // namespace Chip8Emu
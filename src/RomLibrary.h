@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Chip8.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8Emu
+{
+
+enum class RomVariant : unsigned char
+{
+    Chip8,
+    SuperChip, // Uses high resolution, scrolling, big font or flag registers.
+    XoChip     // Uses audio patterns, bit planes or long index.
+};
+
+const char* ToString(RomVariant variant);
+
+// Instructions whose behavior differs between interpreters, so the ROM may need the matching quirk setting.
+enum RomQuirk : unsigned int
+{
+    QuirkNone      = 0,
+    QuirkShift     = 1u << 0u, // 8xy6/8xyE: shift Vx or Vy.
+    QuirkLoadStore = 1u << 1u, // Fx55/Fx65: index is incremented or not.
+    QuirkJump      = 1u << 2u, // Bnnn: jump with V0 or Vx.
+    QuirkClip      = 1u << 3u  // Dxyn: sprites wrap or clip at the screen edge.
+};
+
+struct RomEntry
+{
+    std::string path;
+    unsigned long long hash = 0; // Content hash.
+    const unsigned char* data = nullptr; // Read only mapping of the file, valid while the library is alive.
+    std::size_t size = 0;
+    RomVariant variant = RomVariant::Chip8;
+    unsigned int quirks = QuirkNone; // Combination of RomQuirk.
+};
+
+// Memory maps every ROM of the directory once and indexes them by the content hash.
+// After Scan() loading a ROM is the single copy from the mapping into the machine, without any file I/O.
+class RomLibrary final
+{
+public:
+    RomLibrary() = default;
+    ~RomLibrary();
+
+    RomLibrary(const RomLibrary&) = delete;
+    RomLibrary& operator=(const RomLibrary&) = delete;
+
+    // Adds all regular files of the directory (not recursive). Files with already known content or too large are skipped.
+    // Returns number of added ROMs, problems are collected into GetErrors().
+    std::size_t Scan(const char* directory);
+
+    const std::vector<RomEntry>& GetEntries() const;
+    const RomEntry* Find(unsigned long long hash) const; // nullptr if there is no such ROM, valid until the next Scan().
+    const std::vector<std::string>& GetErrors() const;
+
+    static LoadError Load(const RomEntry& entry, Chip8& chip8);
+
+private:
+    std::vector<RomEntry> entries;
+    std::unordered_map<unsigned long long, std::size_t> index; // Content hash to the entry.
+    std::vector<std::string> errors;
+};
+
+} // namespace Chip8Emu
@@ -0,0 +1,102 @@
+#include "StateHash.h"
+
+#include <cstring>
+
+namespace Chip8Emu
+{
+
+namespace
+{
+
+constexpr unsigned long long Prime1 = 0x9E3779B185EBCA87ull;
+constexpr unsigned long long Prime2 = 0xC2B2AE3D27D4EB4Full;
+
+unsigned long long Rotate(unsigned long long value, unsigned int bits)
+{
+    return (value << bits) | (value >> (64u - bits));
+}
+
+unsigned long long Mix(unsigned long long hash, unsigned long long value)
+{
+    hash ^= Rotate(value * Prime2, 31) * Prime1;
+    return Rotate(hash, 27) * Prime1 + Prime2;
+}
+
+unsigned long long Finalize(unsigned long long hash)
+{
+    hash ^= hash >> 33u;
+    hash *= Prime2;
+    hash ^= hash >> 29u;
+    return hash;
+}
+
+} // namespace
+
+unsigned long long HashBytes(const void* data, std::size_t size, unsigned long long seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    unsigned long long hash = seed + Prime1 + size;
+
+    for (; size >= 8; size -= 8, bytes += 8)
+    {
+        unsigned long long word;
+        std::memcpy(&word, bytes, sizeof(word));
+        hash = Mix(hash, word);
+    }
+
+    unsigned long long tail = 0;
+    std::memcpy(&tail, bytes, size);
+    return Finalize(Mix(hash, tail));
+}
+
+unsigned long long HashMemoryChunk(const unsigned char* memory, unsigned int chunk)
+{
+    return HashBytes(memory + chunk * MemoryChunkSize, MemoryChunkSize, chunk); // Chunk index as a seed, so swapped chunks hash differently.
+}
+
+unsigned long long HashMemory(const unsigned char* memory)
+{
+    unsigned long long hash = 0;
+    for (unsigned int chunk = 0; chunk < MemoryChunkCount; ++chunk)
+    {
+        hash += HashMemoryChunk(memory, chunk);
+    }
+
+    return hash;
+}
+
+unsigned long long HashVideo(const unsigned int* videoMemory)
+{
+    return HashBytes(videoMemory, sizeof(unsigned int) * VideoWidth * VideoHeight);
+}
+
+unsigned long long HashCpu(const Chip8State& state)
+{
+    // Field by field to skip the padding of the structure.
+    unsigned long long hash = HashBytes(state.registers, sizeof(state.registers));
+    hash = HashBytes(state.keypad, sizeof(state.keypad), hash);
+    hash = HashBytes(state.memoryGuard, sizeof(state.memoryGuard), hash);
+    hash = HashBytes(state.stack, sizeof(state.stack), hash);
+    hash = HashBytes(state.audioPattern, sizeof(state.audioPattern), hash);
+
+    const unsigned long long scalars[] =
+    {
+        state.sp, state.delayTimer, state.soundTimer, state.index, state.pc,
+        state.pitch, static_cast<unsigned long long>(state.fault), state.faultAddress,
+        state.randomSeed, state.randomDraws // Instead of the generator itself, its layout is implementation defined.
+    };
+
+    return HashBytes(scalars, sizeof(scalars), hash);
+}
+
+unsigned long long CombineHashes(unsigned long long cpuHash, unsigned long long memoryHash, unsigned long long videoHash)
+{
+    return Finalize(Mix(Mix(Mix(Prime1, cpuHash), memoryHash), videoHash));
+}
+
+unsigned long long HashState(const Chip8State& state)
+{
+    return CombineHashes(HashCpu(state), HashMemory(state.memory), HashVideo(state.videoMemory));
+}
+
+} // namespace Chip8Emu
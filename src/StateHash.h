@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Chip8.h"
+
+#include <cstddef>
+
+namespace Chip8Emu
+{
+
+// Fast non-cryptographic 64 bit hashes of the machine state.
+// Memory hash is the sum of independent chunk hashes, so it can be updated incrementally:
+// memoryHash += HashMemoryChunk(newMemory, chunk) - HashMemoryChunk(oldMemory, chunk).
+unsigned long long HashBytes(const void* data, std::size_t size, unsigned long long seed = 0);
+unsigned long long HashMemoryChunk(const unsigned char* memory, unsigned int chunk);
+unsigned long long HashMemory(const unsigned char* memory);
+unsigned long long HashVideo(const unsigned int* videoMemory);
+unsigned long long HashCpu(const Chip8State& state); // Everything except of the memory and the video memory, the guard area is included.
+unsigned long long CombineHashes(unsigned long long cpuHash, unsigned long long memoryHash, unsigned long long videoHash);
+unsigned long long HashState(const Chip8State& state);
+
+} // namespace Chip8Emu
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "Chip8.h"
+#include "StateHash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Chip8Emu
+{
+
+struct InputEvent
+{
+    unsigned long long instruction = 0; // Keys are applied before this instruction.
+    unsigned short keys = 0; // Bit per key.
+};
+
+struct Divergence
+{
+    bool found = false;
+    unsigned long long instruction = 0; // Index of the first instruction with different results.
+    unsigned short pc = 0; // Address of that instruction in the reference engine.
+    unsigned short opcode = 0;
+    std::string details; // Which parts of the state differ.
+};
+
+// Runs two execution engines in lockstep and compares their state hashes every compareInterval instructions.
+// On mismatch both engines are restored from the last matching checkpoint and the first differing instruction is bisected.
+// Engines have to provide Chip8 interface: Cycle(), GetKeyPad(), GetFault(), SaveState(), LoadState().
+// Caller is responsible for the identical start (same ROM, same Seed()).
+template <typename Reference, typename Candidate>
+class LockstepValidator final
+{
+public:
+    LockstepValidator(Reference& reference, Candidate& candidate, unsigned int compareInterval)
+        : reference(reference)
+        , candidate(candidate)
+        , compareInterval(compareInterval > 0 ? compareInterval : 1)
+        , referenceCheckpoint(std::make_unique<Chip8State>())
+        , candidateCheckpoint(std::make_unique<Chip8State>())
+        , referenceCurrent(std::make_unique<Chip8State>())
+        , candidateCurrent(std::make_unique<Chip8State>())
+    {
+    }
+
+    void SetInput(std::vector<InputEvent> events) // Events are sorted by the instruction.
+    {
+        input = std::move(events);
+        std::stable_sort(input.begin(), input.end(), [](const InputEvent& left, const InputEvent& right) { return left.instruction < right.instruction; });
+    }
+
+    // Executes the instructions or stops earlier on divergence or once the reference engine faults.
+    Divergence Run(unsigned long long instructions)
+    {
+        executed = 0;
+        nextEvent = 0;
+
+        reference.SaveState(*referenceCheckpoint);
+        candidate.SaveState(*candidateCheckpoint);
+        if (HashState(*referenceCheckpoint) != HashState(*candidateCheckpoint))
+        {
+            Divergence divergence;
+            divergence.found = true;
+            divergence.pc = referenceCheckpoint->pc;
+            divergence.details = "initial state: " + Describe(*referenceCheckpoint, *candidateCheckpoint);
+            return divergence;
+        }
+
+        while (executed < instructions && referenceCheckpoint->fault == Fault::None)
+        {
+            unsigned long long steps = std::min<unsigned long long>(compareInterval, instructions - executed);
+            for (unsigned long long i = 0; i < steps; ++i)
+            {
+                Step(executed + i);
+                if (reference.GetFault() != Fault::None) // Faulted machine doesn't execute anything anymore.
+                {
+                    steps = i + 1;
+                    break;
+                }
+            }
+
+            reference.SaveState(*referenceCurrent);
+            candidate.SaveState(*candidateCurrent);
+            if (HashState(*referenceCurrent) != HashState(*candidateCurrent))
+            {
+                return Bisect(steps);
+            }
+
+            executed += steps;
+            std::swap(referenceCheckpoint, referenceCurrent);
+            std::swap(candidateCheckpoint, candidateCurrent);
+        }
+
+        return Divergence{};
+    }
+
+    unsigned long long GetExecutedCount() const
+    {
+        return executed;
+    }
+
+private:
+    void Step(unsigned long long instruction)
+    {
+        for (; nextEvent < input.size() && input[nextEvent].instruction <= instruction; ++nextEvent)
+        {
+            for (unsigned int key = 0; key < KeyCount; ++key)
+            {
+                const unsigned char pressed = (input[nextEvent].keys >> key) & 1u;
+                reference.GetKeyPad()[key] = pressed;
+                candidate.GetKeyPad()[key] = pressed;
+            }
+        }
+
+        reference.Cycle();
+        candidate.Cycle();
+    }
+
+    // Restores the checkpoint and executes steps instructions after it. Returns true if the engines still match.
+    bool Replay(unsigned long long steps)
+    {
+        reference.LoadState(*referenceCheckpoint);
+        candidate.LoadState(*candidateCheckpoint);
+
+        // Keypad in the checkpoint has events before the instruction "executed" applied, the rest are applied by Step().
+        nextEvent = std::lower_bound(input.begin(), input.end(), executed,
+            [](const InputEvent& event, unsigned long long instruction) { return event.instruction < instruction; }) - input.begin();
+
+        for (unsigned long long i = 0; i < steps; ++i)
+        {
+            Step(executed + i);
+        }
+
+        reference.SaveState(*referenceCurrent);
+        candidate.SaveState(*candidateCurrent);
+        return HashState(*referenceCurrent) == HashState(*candidateCurrent);
+    }
+
+    Divergence Bisect(unsigned long long mismatch)
+    {
+        unsigned long long match = 0; // Checkpoint itself matches.
+        while (mismatch - match > 1)
+        {
+            const unsigned long long middle = match + (mismatch - match) / 2;
+            if (Replay(middle))
+            {
+                match = middle;
+            }
+            else
+            {
+                mismatch = middle;
+            }
+        }
+
+        Divergence divergence;
+        divergence.found = true;
+        divergence.instruction = executed + mismatch - 1;
+
+        Replay(mismatch - 1);
+        divergence.pc = referenceCurrent->pc;
+        divergence.opcode = (referenceCurrent->memory[divergence.pc & AddressMask] << 8u) | referenceCurrent->memory[(divergence.pc + 1) & AddressMask];
+
+        Replay(mismatch);
+        divergence.details = Describe(*referenceCurrent, *candidateCurrent);
+        return divergence;
+    }
+
+    static std::string Describe(const Chip8State& left, const Chip8State& right)
+    {
+        std::string details;
+        char buffer[96];
+
+        for (unsigned int i = 0; i < 16; ++i)
+        {
+            if (left.registers[i] != right.registers[i])
+            {
+                std::snprintf(buffer, sizeof(buffer), "V%X %02X != %02X; ", i, left.registers[i], right.registers[i]);
+                details += buffer;
+            }
+        }
+
+        const auto compare = [&](const char* name, unsigned int leftValue, unsigned int rightValue)
+        {
+            if (leftValue != rightValue)
+            {
+                std::snprintf(buffer, sizeof(buffer), "%s %X != %X; ", name, leftValue, rightValue);
+                details += buffer;
+            }
+        };
+
+        compare("PC", left.pc, right.pc);
+        compare("I", left.index, right.index);
+        compare("SP", left.sp, right.sp);
+        compare("DT", left.delayTimer, right.delayTimer);
+        compare("ST", left.soundTimer, right.soundTimer);
+        compare("fault", static_cast<unsigned int>(left.fault), static_cast<unsigned int>(right.fault));
+
+        for (unsigned int address = 0; address < MemorySize; ++address)
+        {
+            if (left.memory[address] != right.memory[address])
+            {
+                std::snprintf(buffer, sizeof(buffer), "memory[%03X] %02X != %02X; ", address, left.memory[address], right.memory[address]);
+                details += buffer;
+                break; // First one is enough to start looking.
+            }
+        }
+
+        if (std::memcmp(left.memoryGuard, right.memoryGuard, sizeof(left.memoryGuard)) != 0)
+        {
+            details += "memory guard; ";
+        }
+
+        if (std::memcmp(left.stack, right.stack, sizeof(left.stack)) != 0)
+        {
+            details += "stack; ";
+        }
+
+        if (std::memcmp(left.videoMemory, right.videoMemory, sizeof(left.videoMemory)) != 0)
+        {
+            details += "video memory; ";
+        }
+
+        if (std::memcmp(left.keypad, right.keypad, sizeof(left.keypad)) != 0)
+        {
+            details += "keypad; ";
+        }
+
+        if (std::memcmp(left.audioPattern, right.audioPattern, sizeof(left.audioPattern)) != 0 || left.pitch != right.pitch)
+        {
+            details += "audio; ";
+        }
+
+        if (left.randomSeed != right.randomSeed || left.randomDraws != right.randomDraws || !(left.randGen == right.randGen))
+        {
+            details += "random generator; ";
+        }
+
+        return details;
+    }
+
+private:
+    Reference& reference;
+    Candidate& candidate;
+    unsigned int compareInterval = 0;
+    std::vector<InputEvent> input;
+    std::size_t nextEvent = 0;
+    unsigned long long executed = 0; // Instructions before the last matching checkpoint.
+
+    std::unique_ptr<Chip8State> referenceCheckpoint;
+    std::unique_ptr<Chip8State> candidateCheckpoint;
+    std::unique_ptr<Chip8State> referenceCurrent;
+    std::unique_ptr<Chip8State> candidateCurrent;
+};
+
+struct FuzzResult
+{
+    Divergence divergence;
+    unsigned long long programs = 0; // Programs checked before the divergence.
+    unsigned long long instructions = 0;
+};
+
+// Runs both engines over random instruction streams with random registers and keypad.
+template <typename Reference, typename Candidate>
+FuzzResult Fuzz(unsigned long long programs, unsigned long long instructionsPerProgram, unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<unsigned int> randByte(0, 255u);
+
+    FuzzResult result;
+    auto reference = std::make_unique<Reference>();
+    auto candidate = std::make_unique<Candidate>();
+    auto initial = std::make_unique<Chip8State>();
+    reference->SaveState(*initial); // Fonts and the rest of the power on state.
+
+    auto state = std::make_unique<Chip8State>();
+    LockstepValidator<Reference, Candidate> validator(*reference, *candidate, static_cast<unsigned int>(instructionsPerProgram));
+    for (; result.programs < programs; ++result.programs)
+    {
+        *state = *initial;
+        for (unsigned int address = StartAddress; address < MemorySize; address += 4)
+        {
+            const unsigned int word = generator();
+            std::memcpy(state->memory + address, &word, 4);
+        }
+
+        for (unsigned char& value : state->registers)
+        {
+            value = static_cast<unsigned char>(randByte(generator));
+        }
+
+        for (unsigned char& key : state->keypad)
+        {
+            key = randByte(generator) & 1u;
+        }
+
+        state->randomSeed = generator();
+        state->randomDraws = 0;
+        state->randGen.seed(state->randomSeed);
+
+        reference->LoadState(*state);
+        candidate->LoadState(*state);
+
+        result.divergence = validator.Run(instructionsPerProgram);
+        result.instructions += validator.GetExecutedCount();
+        if (result.divergence.found)
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+} // namespace Chip8Emu
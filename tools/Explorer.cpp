@@ -0,0 +1,70 @@
+#include "Chip8.h"
+#include "Explorer.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " ROMPath <MaxDepth> <MaxStates> <Threads>(0 - all cores) <Seed>\n";
+        return EXIT_FAILURE;
+    }
+
+    const char* romPath = argv[1];
+    Chip8Emu::ExplorerSettings settings;
+    settings.maxDepth = argc > 2 ? std::stoul(argv[2]) : settings.maxDepth;
+    settings.maxStates = argc > 3 ? std::stoull(argv[3]) : settings.maxStates;
+    settings.threads = argc > 4 ? std::stoul(argv[4]) : settings.threads;
+    const unsigned int seed = argc > 5 ? std::stoul(argv[5]) : 1;
+
+    auto chip8 = std::make_unique<Chip8Emu::Chip8>();
+    const Chip8Emu::LoadError loadError = chip8->LoadROM(romPath);
+    if (loadError != Chip8Emu::LoadError::None)
+    {
+        std::cerr << "Failed to load ROM " << romPath << ": " << Chip8Emu::ToString(loadError) << '\n';
+        return EXIT_FAILURE;
+    }
+    chip8->Seed(seed);
+
+    auto start = std::make_unique<Chip8Emu::Chip8State>();
+    chip8->SaveState(*start);
+
+    const auto startTime = std::chrono::steady_clock::now();
+    Chip8Emu::StateExplorer explorer(settings);
+    const Chip8Emu::ExplorerReport report = explorer.Explore(*start);
+    const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "Depth " << report.depth << ", decisions " << report.decisions << ", instructions " << report.instructions
+              << " in " << seconds << "s\n"
+              << "Unique states " << report.uniqueStates << " (pruned " << report.duplicateStates << "), unique frames " << report.uniqueFrames << '\n'
+              << "Covered " << report.coverage.count() << " instruction addresses:";
+
+    // Print the covered addresses as ranges of the consecutive instructions.
+    std::cout << std::hex;
+    for (unsigned int address = 0; address < Chip8Emu::MemorySize; ++address)
+    {
+        if (!report.coverage[address])
+        {
+            continue;
+        }
+
+        unsigned int last = address;
+        while (last + 2 < Chip8Emu::MemorySize && report.coverage[last + 2])
+        {
+            last += 2;
+        }
+
+        std::cout << " 0x" << address;
+        if (last != address)
+        {
+            std::cout << "-0x" << last;
+        }
+        address = last;
+    }
+    std::cout << std::dec << '\n';
+
+    return 0;
+}
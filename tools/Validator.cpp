@@ -0,0 +1,205 @@
+#include "Chip8.h"
+#include "RomLibrary.h"
+#include "Validator.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+
+namespace
+{
+
+// Replace the candidate with the new execution engine to validate it against the reference interpreter.
+using ReferenceEngine = Chip8Emu::Chip8;
+using CandidateEngine = Chip8Emu::Chip8;
+
+void PrintDivergence(const Chip8Emu::Divergence& divergence)
+{
+    std::cout << "Divergence at instruction " << divergence.instruction << std::hex
+        << " (pc 0x" << divergence.pc << ", opcode 0x" << divergence.opcode << std::dec << "): "
+        << divergence.details << '\n';
+}
+
+// Candidate which corrupts V0 once an instruction is executed with key 3 held.
+class KeyFaultyEngine final
+{
+public:
+    void Cycle()
+    {
+        chip8.Cycle();
+        if (chip8.GetKeyPad()[3])
+        {
+            chip8.GetRegisters()[0] = 1; // Sticky, so the engines never match again after the press.
+        }
+    }
+
+    unsigned char* GetKeyPad() { return chip8.GetKeyPad(); }
+    Chip8Emu::Fault GetFault() const { return chip8.GetFault(); }
+    void SaveState(Chip8Emu::Chip8State& state) const { chip8.SaveState(state); }
+    void LoadState(const Chip8Emu::Chip8State& state) { chip8.LoadState(state); }
+    Chip8Emu::LoadError LoadROM(const unsigned char* data, std::size_t size) { return chip8.LoadROM(data, size); }
+    void Seed(unsigned int seed) { chip8.Seed(seed); }
+
+private:
+    Chip8Emu::Chip8 chip8;
+};
+
+// Checks that the bisection finds the instruction where the key goes down, including the events at the checkpoints.
+bool SelfTest()
+{
+    constexpr unsigned int Interval = 1000;
+    const unsigned char rom[] = {0x12, 0x00}; // Infinite jump to itself.
+    const unsigned long long pressInstructions[] = {0, 1, Interval - 1, Interval, Interval + 1, 2 * Interval};
+
+    bool passed = true;
+    for (const unsigned long long pressInstruction : pressInstructions)
+    {
+        auto reference = std::make_unique<Chip8Emu::Chip8>();
+        auto candidate = std::make_unique<KeyFaultyEngine>();
+        reference->LoadROM(rom, sizeof(rom));
+        candidate->LoadROM(rom, sizeof(rom));
+        reference->Seed(1);
+        candidate->Seed(1);
+
+        Chip8Emu::LockstepValidator<Chip8Emu::Chip8, KeyFaultyEngine> validator(*reference, *candidate, Interval);
+        validator.SetInput({{pressInstruction, 1u << 3u}});
+
+        const Chip8Emu::Divergence divergence = validator.Run(10 * Interval);
+        if (!divergence.found || divergence.instruction != pressInstruction || divergence.details.empty())
+        {
+            std::cout << "Self test failed for the key press at instruction " << pressInstruction << ": ";
+            PrintDivergence(divergence);
+            passed = false;
+        }
+    }
+
+    std::cout << (passed ? "Self test passed\n" : "Self test failed\n");
+    return passed;
+}
+
+float MillionsPerSecond(unsigned long long instructions, std::chrono::steady_clock::time_point start)
+{
+    const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    return seconds > 0 ? instructions / seconds / 1000000.0f : 0.0f;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " ROMPath(file or directory) <Instructions> <CompareInterval> <Seed>\n"
+                  << "       " << argv[0] << " --fuzz <Programs> <InstructionsPerProgram> <Seed>\n"
+                  << "       " << argv[0] << " --selftest\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    if (std::strcmp(argv[1], "--selftest") == 0)
+    {
+        return SelfTest() ? 0 : EXIT_FAILURE;
+    }
+
+    if (std::strcmp(argv[1], "--fuzz") == 0)
+    {
+        const unsigned long long programs = argc > 2 ? std::stoull(argv[2]) : 10000;
+        const unsigned long long instructions = argc > 3 ? std::stoull(argv[3]) : 1000;
+        const unsigned int seed = argc > 4 ? std::stoul(argv[4]) : 1;
+
+        const Chip8Emu::FuzzResult result = Chip8Emu::Fuzz<ReferenceEngine, CandidateEngine>(programs, instructions, seed);
+        std::cout << "Fuzzed " << result.programs << " programs, " << result.instructions << " instructions, "
+                  << MillionsPerSecond(result.instructions, start) << " MIPS\n";
+        if (result.divergence.found)
+        {
+            PrintDivergence(result.divergence);
+            return EXIT_FAILURE;
+        }
+        return 0;
+    }
+
+    const char* romPath = argv[1];
+    const unsigned long long instructions = argc > 2 ? std::stoull(argv[2]) : 10000000;
+    const unsigned int interval = argc > 3 ? std::stoul(argv[3]) : 1000;
+    const unsigned int seed = argc > 4 ? std::stoul(argv[4]) : 1;
+
+    // Directory is swept ROM by ROM, files are mapped once and every load is the copy from the mapping.
+    Chip8Emu::RomLibrary library;
+    std::vector<const Chip8Emu::RomEntry*> roms;
+    const bool sweep = std::filesystem::is_directory(romPath);
+    if (sweep)
+    {
+        library.Scan(romPath);
+        for (const std::string& error : library.GetErrors())
+        {
+            std::cerr << error << '\n';
+        }
+
+        for (const Chip8Emu::RomEntry& entry : library.GetEntries())
+        {
+            roms.push_back(&entry);
+        }
+    }
+
+    auto reference = std::make_unique<ReferenceEngine>();
+    auto candidate = std::make_unique<CandidateEngine>();
+    auto powerOn = std::make_unique<Chip8Emu::Chip8State>();
+    reference->SaveState(*powerOn);
+
+    unsigned long long executed = 0;
+    bool failed = false;
+    for (std::size_t rom = 0; rom < (sweep ? roms.size() : 1); ++rom)
+    {
+        const char* name = sweep ? roms[rom]->path.c_str() : romPath;
+
+        reference->LoadState(*powerOn);
+        candidate->LoadState(*powerOn);
+        Chip8Emu::LoadError loadError = sweep ? Chip8Emu::RomLibrary::Load(*roms[rom], *reference) : reference->LoadROM(romPath);
+        if (loadError == Chip8Emu::LoadError::None)
+        {
+            loadError = sweep ? Chip8Emu::RomLibrary::Load(*roms[rom], *candidate) : candidate->LoadROM(romPath);
+        }
+
+        if (loadError != Chip8Emu::LoadError::None)
+        {
+            std::cerr << "Failed to load ROM " << name << ": " << Chip8Emu::ToString(loadError) << '\n';
+            failed = true;
+            continue;
+        }
+
+        reference->Seed(seed);
+        candidate->Seed(seed);
+
+        // Same pseudo random keypad input for both engines, new combination every few thousands instructions.
+        std::mt19937 generator(seed);
+        std::vector<Chip8Emu::InputEvent> input;
+        for (unsigned long long instruction = 0; instruction < instructions; instruction += 1000 + generator() % 4000)
+        {
+            input.push_back({instruction, static_cast<unsigned short>(generator() & generator() & 0xFFFFu)}); // Few keys at once.
+        }
+
+        Chip8Emu::LockstepValidator<ReferenceEngine, CandidateEngine> validator(*reference, *candidate, interval);
+        validator.SetInput(std::move(input));
+
+        const Chip8Emu::Divergence divergence = validator.Run(instructions);
+        executed += validator.GetExecutedCount();
+        if (divergence.found)
+        {
+            std::cout << name << ": ";
+            PrintDivergence(divergence);
+            failed = true;
+        }
+    }
+
+    std::cout << "Executed " << executed << " instructions, " << MillionsPerSecond(executed, start) << " MIPS\n";
+    if (failed)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}